@@ -97,7 +97,9 @@ void ApplicationManager::exec()
   
   m_event_loop_updater = new EventLoopUpdater(m_engine, jl_get_function(m_qml_mod, "process_eventloop_updates"));
 
-  ForeignThreadManager::instance(); // Make sure the main thread is put in GC safe mode
+  // The main thread only runs Julia code from callbacks while in the event loop. cleanup leaves GC safe mode again.
+  ForeignThreadManager::instance().gc_safe_enter();
+  ForeignThreadManager::prewarm_thread_pool();
   const int status = app->exec();
   if (status != 0)
   {
@@ -139,6 +141,8 @@ ApplicationManager::ApplicationManager()
 
 void ApplicationManager::cleanup()
 {
+  // Async calls still running use functions owned by the engine
+  ForeignThreadManager::stop_thread_pool();
   if(m_engine != nullptr)
   {
     delete m_engine;
@@ -184,8 +188,13 @@ EventLoopUpdater::EventLoopUpdater(QObject *parent, jl_value_t *f) : QObject(par
 
 void EventLoopUpdater::process_eventloop_updates()
 {
-  GCGuard gc_guard;
-  m_process_eventloop_updates();
+  GCGuard gc_guard(JuliaPriority::Normal, "process_eventloop_updates");
+  // Each call is a slice of work, the Julia function returns true while more updates are pending
+  ForeignThreadManager& manager = ForeignThreadManager::instance();
+  while(m_process_eventloop_updates() == jl_true)
+  {
+    manager.yield_to_higher_priority();
+  }
 }
 
 }
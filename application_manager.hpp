@@ -19,7 +19,8 @@
 namespace qmlwrap
 {
 
-/// Helper to invoke a Julia function inside the main event loop
+/// Helper to invoke a Julia function inside the main event loop. The function is called again as long as it returns
+/// true, and threads with a higher priority can enter Julia between the calls.
 class EventLoopUpdater : public QObject
 {
   Q_OBJECT
@@ -0,0 +1,100 @@
+#include "call_profile.hpp"
+#include "lock_profiler.hpp"
+
+namespace qmlwrap
+{
+
+std::atomic<bool> CallProfile::m_enabled{false};
+
+namespace
+{
+  thread_local CallProfile::Timer* current_timer = nullptr;
+}
+
+CallProfile::Timer::Timer(CallProfile& profile) : m_profile(profile), m_previous(current_timer), m_start(enabled() ? LockProfiler::now() : 0)
+{
+  current_timer = this;
+}
+
+CallProfile::Timer::~Timer()
+{
+  current_timer = m_previous;
+  if(m_start != 0)
+  {
+    const uint64_t end = LockProfiler::now();
+    m_profile.record(end - m_start, (m_entered != 0 ? m_entered : end) - m_start, m_conversion_ns);
+  }
+}
+
+void CallProfile::Timer::entered()
+{
+  if(m_start != 0)
+  {
+    m_entered = LockProfiler::now();
+  }
+}
+
+void CallProfile::Timer::begin_conversion()
+{
+  if(m_start != 0)
+  {
+    m_conversion_start = LockProfiler::now();
+  }
+}
+
+void CallProfile::Timer::end_conversion()
+{
+  if(m_start != 0)
+  {
+    m_conversion_ns += LockProfiler::now() - m_conversion_start;
+  }
+}
+
+void CallProfile::add_conversion_time(uint64_t ns)
+{
+  if(current_timer != nullptr && current_timer->m_start != 0)
+  {
+    current_timer->m_conversion_ns += ns;
+  }
+}
+
+void CallProfile::set_enabled(bool enabled)
+{
+  m_enabled = enabled;
+}
+
+void CallProfile::record(uint64_t total_ns, uint64_t wait_ns, uint64_t conversion_ns)
+{
+  m_calls.record(total_ns);
+  m_wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+  m_conversion_ns.fetch_add(conversion_ns, std::memory_order_relaxed);
+
+  uint64_t current = m_min_ns.load(std::memory_order_relaxed);
+  while(total_ns < current && !m_min_ns.compare_exchange_weak(current, total_ns, std::memory_order_relaxed))
+  {
+  }
+}
+
+QVariantMap CallProfile::stats() const
+{
+  const uint64_t count = m_calls.count();
+  QVariantMap result;
+  result["count"] = qulonglong(count);
+  result["total_ns"] = qulonglong(m_calls.total_ns());
+  result["min_ns"] = qulonglong(count == 0 ? 0 : m_min_ns.load(std::memory_order_relaxed));
+  result["max_ns"] = qulonglong(m_calls.max_ns());
+  result["p99_ns"] = qulonglong(m_calls.quantile(0.99));
+  result["wait_ns"] = qulonglong(m_wait_ns.load(std::memory_order_relaxed));
+  result["conversion_ns"] = qulonglong(m_conversion_ns.load(std::memory_order_relaxed));
+  return result;
+}
+
+void CallProfile::reset()
+{
+  m_calls.clear();
+  m_min_ns = UINT64_MAX;
+  m_wait_ns = 0;
+  m_conversion_ns = 0;
+}
+
+} // namespace qmlwrap
@@ -0,0 +1,73 @@
+#ifndef QML_CALL_PROFILE_H
+#define QML_CALL_PROFILE_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <QVariantMap>
+
+#include "duration_histogram.hpp"
+
+namespace qmlwrap
+{
+
+/// Timing statistics of the calls to one Julia function registered with qmlfunction or qmlfunction_typed. Calls can
+/// come from any thread.
+class CallProfile
+{
+public:
+  // Times a call from construction to destruction, while profiling is enabled. entered marks when the Julia lock was
+  // obtained, and the time between begin_conversion and end_conversion is added to the conversion time. The innermost
+  // timer of each thread is the current one, which receives the conversion time reported by the Julia call trampoline.
+  class Timer
+  {
+  public:
+    Timer(CallProfile& profile);
+    ~Timer();
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    void entered();
+    void begin_conversion();
+    void end_conversion();
+
+  private:
+    friend class CallProfile;
+
+    CallProfile& m_profile;
+    Timer* m_previous;
+    uint64_t m_start;
+    uint64_t m_entered = 0;
+    uint64_t m_conversion_start = 0;
+    uint64_t m_conversion_ns = 0;
+  };
+
+  static bool enabled()
+  {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+  static void set_enabled(bool enabled);
+
+  // Adds the time the Julia side spent converting the arguments and the result to the current call on this thread
+  static void add_conversion_time(uint64_t ns);
+
+  // Durations in nanoseconds of the whole call, of waiting for the Julia lock and of converting the arguments and the
+  // result
+  void record(uint64_t total_ns, uint64_t wait_ns, uint64_t conversion_ns);
+
+  // Count, total, min, max and 99th percentile of the call time, and total lock wait and conversion time
+  QVariantMap stats() const;
+  void reset();
+
+private:
+  DurationHistogram m_calls;
+  std::atomic<uint64_t> m_min_ns{UINT64_MAX};
+  std::atomic<uint64_t> m_wait_ns{0};
+  std::atomic<uint64_t> m_conversion_ns{0};
+
+  static std::atomic<bool> m_enabled;
+};
+
+} // namespace qmlwrap
+
+#endif
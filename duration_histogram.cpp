@@ -0,0 +1,84 @@
+#include "duration_histogram.hpp"
+
+#include <algorithm>
+
+#include <QtAlgorithms>
+
+namespace qmlwrap
+{
+
+namespace
+{
+  // Only the owning thread writes, so a load and a store are enough
+  inline void add(std::atomic<uint64_t>& counter, uint64_t value)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+}
+
+int DurationHistogram::bucket(uint64_t ns)
+{
+  const int i = ns == 0 ? 0 : 64 - qCountLeadingZeroBits(quint64(ns));
+  return i < nb_buckets ? i : nb_buckets - 1;
+}
+
+void DurationHistogram::record(uint64_t ns)
+{
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_total_ns.fetch_add(ns, std::memory_order_relaxed);
+  uint64_t current = m_max_ns.load(std::memory_order_relaxed);
+  while(ns > current && !m_max_ns.compare_exchange_weak(current, ns, std::memory_order_relaxed))
+  {
+  }
+  m_buckets[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void DurationHistogram::record_single_writer(uint64_t ns)
+{
+  add(m_count, 1);
+  add(m_total_ns, ns);
+  if(ns > m_max_ns.load(std::memory_order_relaxed))
+  {
+    m_max_ns.store(ns, std::memory_order_relaxed);
+  }
+  add(m_buckets[bucket(ns)], 1);
+}
+
+void DurationHistogram::clear()
+{
+  m_count = 0;
+  m_total_ns = 0;
+  m_max_ns = 0;
+  for(std::atomic<uint64_t>& b : m_buckets)
+  {
+    b = 0;
+  }
+}
+
+uint64_t DurationHistogram::quantile(double q) const
+{
+  const uint64_t n = count();
+  const uint64_t max = max_ns();
+  uint64_t seen = 0;
+  for(int i = 0; i != nb_buckets && n != 0; ++i)
+  {
+    seen += m_buckets[i].load(std::memory_order_relaxed);
+    if(seen >= q*n)
+    {
+      return std::min(uint64_t(1) << i, max);
+    }
+  }
+  return max;
+}
+
+QVariantList DurationHistogram::buckets() const
+{
+  QVariantList result;
+  for(const std::atomic<uint64_t>& b : m_buckets)
+  {
+    result.push_back(qulonglong(b.load(std::memory_order_relaxed)));
+  }
+  return result;
+}
+
+} // namespace qmlwrap
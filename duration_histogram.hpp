@@ -0,0 +1,43 @@
+#ifndef QML_DURATION_HISTOGRAM_H
+#define QML_DURATION_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <QVariantList>
+
+namespace qmlwrap
+{
+
+/// Count, total, maximum and log2 histogram of durations in nanoseconds, using relaxed atomics only
+class DurationHistogram
+{
+public:
+  // Bucket i counts the durations d with 2^(i-1) <= d < 2^i nanoseconds, the last one everything above
+  static constexpr int nb_buckets = 40;
+
+  // Safe with concurrent writers
+  void record(uint64_t ns);
+  // Cheaper, for a histogram that only one thread writes to
+  void record_single_writer(uint64_t ns);
+  void clear();
+
+  uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+  uint64_t total_ns() const { return m_total_ns.load(std::memory_order_relaxed); }
+  uint64_t max_ns() const { return m_max_ns.load(std::memory_order_relaxed); }
+  // Upper bound of the bucket containing the given quantile, at most the maximum
+  uint64_t quantile(double q) const;
+  QVariantList buckets() const;
+
+private:
+  static int bucket(uint64_t ns);
+
+  std::atomic<uint64_t> m_count{0};
+  std::atomic<uint64_t> m_total_ns{0};
+  std::atomic<uint64_t> m_max_ns{0};
+  std::atomic<uint64_t> m_buckets[nb_buckets] = {};
+};
+
+} // namespace qmlwrap
+
+#endif
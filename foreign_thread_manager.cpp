@@ -1,13 +1,18 @@
 #include "jlcxx/jlcxx.hpp"
 
+#include <QSemaphore>
+
 #include "foreign_thread_manager.hpp"
 
 
 namespace qmlwrap
 {
 
-QMutex ForeignThreadManager::m_juliamutex;
+PriorityMutex ForeignThreadManager::m_juliamutex;
 thread_local ForeignThreadManager* ForeignThreadManager::m_instance = nullptr;
+std::atomic<int> ForeignThreadManager::m_nb_adopted(0);
+QThreadPool* ForeignThreadManager::m_thread_pool = nullptr;
+int ForeignThreadManager::m_thread_pool_size = 0;
 
 ForeignThreadManager& ForeignThreadManager::instance()
 {
@@ -25,39 +30,69 @@ ForeignThreadManager::~ForeignThreadManager()
 
 ForeignThreadManager::ForeignThreadManager()
 {
+  // Threads unknown to Julia are adopted and marked as not running Julia code. Julia threads, including the main thread,
+  // are running Julia code when they get here, so their state is kept until exec puts the main thread in GC safe mode.
+  #if (JULIA_VERSION_MAJOR * 100 + JULIA_VERSION_MINOR) >= 109
+  if (jl_get_pgcstack() == nullptr)
+  {
+    jl_adopt_thread();
+    ++m_nb_adopted;
+    gc_safe_enter();
+  }
+  #else
   if (!QThread::isMainThread())
   {
-    #if (JULIA_VERSION_MAJOR * 100 + JULIA_VERSION_MINOR) >= 109
-      jl_adopt_thread();
-    #endif
+    gc_safe_enter();
   }
-  gc_safe_enter();
+  #endif
 }
 
 void ForeignThreadManager::gc_safe_enter()
 {
+  if(m_gc_safe)
+  {
+    return;
+  }
   jl_ptls_t ptls = jl_current_task->ptls;
   m_state = jl_gc_safe_enter(ptls);
   #if (JULIA_VERSION_MAJOR * 100 + JULIA_VERSION_MINOR) > 111
   ptls->engine_nqueued++;
   #endif
+  m_gc_safe = true;
 }
 
 void ForeignThreadManager::gc_safe_leave()
 {
+  if(!m_gc_safe)
+  {
+    return;
+  }
   jl_ptls_t ptls = jl_current_task->ptls;
   jl_gc_safe_leave(ptls, m_state);
   #if (JULIA_VERSION_MAJOR * 100 + JULIA_VERSION_MINOR) > 111
   ptls->engine_nqueued--;
   #endif
+  m_gc_safe = false;
 }
 
-void ForeignThreadManager::begin_julia()
+void ForeignThreadManager::begin_julia(const char* tag, JuliaPriority priority)
 {
-  if(m_depth == 0)
+  const bool profile = LockProfiler::enabled() && m_depth < LockProfiler::max_depth;
+  const uint64_t wait_start = profile ? LockProfiler::now() : 0;
+  // A thread that is already running Julia code, e.g. in a callback from process_events, enters directly
+  if(m_depth == 0 && m_gc_safe)
   {
-    m_juliamutex.lock();
+    m_juliamutex.lock(priority);
     gc_safe_leave();
+    m_locked = true;
+    m_priority = priority;
+  }
+  if(m_depth < LockProfiler::max_depth)
+  {
+    Entry& entry = m_entries[m_depth];
+    entry.tag = tag;
+    entry.start = profile ? LockProfiler::now() : 0;
+    entry.wait = entry.start - wait_start;
   }
   ++m_depth;
 }
@@ -65,17 +100,41 @@ void ForeignThreadManager::begin_julia()
 void ForeignThreadManager::end_julia()
 {
   --m_depth;
-  if(m_depth == 0)
+  const Entry* entry = (m_depth < LockProfiler::max_depth && m_entries[m_depth].start != 0) ? &m_entries[m_depth] : nullptr;
+  const uint64_t end = entry != nullptr ? LockProfiler::now() : 0;
+  if(m_depth == 0 && m_locked)
   {
+    m_locked = false;
     gc_safe_enter();
     m_juliamutex.unlock();
   }
+  // Recorded after unlocking, so the bookkeeping is not part of the hold time of other threads
+  if(entry != nullptr)
+  {
+    LockProfiler::record(entry->tag, m_depth, entry->wait, end - entry->start);
+  }
 }
 
 void ForeignThreadManager::yield()
 {
+  if(m_depth == 0)
+  {
+    return;
+  }
+  const char* tag = m_depth <= LockProfiler::max_depth ? m_entries[m_depth-1].tag : "yield";
+  const JuliaPriority priority = m_priority;
   end_julia();
-  begin_julia();
+  begin_julia(tag, priority);
+}
+
+void ForeignThreadManager::yield_to_higher_priority()
+{
+  // Only an outermost entry holding the lock can hand it over
+  if(m_depth != 1 || !m_locked || !m_juliamutex.has_waiters_above(m_priority))
+  {
+    return;
+  }
+  yield();
 }
 
 void ForeignThreadManager::cleanup()
@@ -88,9 +147,92 @@ void ForeignThreadManager::cleanup()
   m_instance = nullptr;
 }
 
-GCGuard::GCGuard()
+QThreadPool& ForeignThreadManager::thread_pool()
+{
+  if(m_thread_pool == nullptr)
+  {
+    m_thread_pool = new QThreadPool();
+    m_thread_pool->setExpiryTimeout(-1);
+    if(m_thread_pool_size > 0)
+    {
+      m_thread_pool->setMaxThreadCount(m_thread_pool_size);
+    }
+  }
+  return *m_thread_pool;
+}
+
+void ForeignThreadManager::set_thread_pool_size(int size)
+{
+  if(size <= 0)
+  {
+    throw std::runtime_error("Thread pool size must be positive");
+  }
+  m_thread_pool_size = size;
+  if(m_thread_pool != nullptr)
+  {
+    m_thread_pool->setMaxThreadCount(size);
+  }
+}
+
+void ForeignThreadManager::prewarm_thread_pool()
+{
+  QThreadPool& pool = thread_pool();
+  const int nb_threads = pool.maxThreadCount() - pool.activeThreadCount();
+  if(nb_threads <= 0)
+  {
+    return;
+  }
+  // Each task blocks until all have started, so they all get their own thread
+  auto started = std::make_shared<QSemaphore>();
+  auto release = std::make_shared<QSemaphore>();
+  for(int i = 0; i != nb_threads; ++i)
+  {
+    pool.start([started, release] ()
+    {
+      ForeignThreadManager::instance();
+      started->release();
+      release->acquire();
+    });
+  }
+  started->acquire(nb_threads);
+  release->release(nb_threads);
+}
+
+void ForeignThreadManager::stop_thread_pool()
+{
+  if(m_thread_pool == nullptr)
+  {
+    return;
+  }
+  // Waiting must not hold up a garbage collection triggered by the pool threads
+  ForeignThreadManager& manager = instance();
+  const bool was_gc_safe = manager.m_gc_safe;
+  manager.gc_safe_enter();
+  delete m_thread_pool;
+  m_thread_pool = nullptr;
+  if(!was_gc_safe)
+  {
+    manager.gc_safe_leave();
+  }
+}
+
+QVariantMap ForeignThreadManager::thread_stats()
+{
+  QVariantMap result;
+  result["adopted"] = m_nb_adopted.load();
+  result["pool_size"] = m_thread_pool != nullptr ? m_thread_pool->maxThreadCount() : m_thread_pool_size;
+  result["pool_active"] = m_thread_pool != nullptr ? m_thread_pool->activeThreadCount() : 0;
+  return result;
+}
+
+GCGuard::GCGuard(const char* tag)
+{
+  ForeignThreadManager::instance().begin_julia(tag);
+}
+
+GCGuard::GCGuard(JuliaPriority priority, const char* tag)
 {
-  ForeignThreadManager::instance().begin_julia();
+  ForeignThreadManager::instance().begin_julia(tag, priority);
 }
 
 GCGuard::~GCGuard()
@@ -1,7 +1,14 @@
+#include <array>
+#include <atomic>
+
 #include <QSet>
-#include <QMutex>
 #include <QQuickItem>
 #include <QThread>
+#include <QThreadPool>
+#include <QVariantMap>
+
+#include "lock_profiler.hpp"
+#include "priority_mutex.hpp"
 
 
 namespace qmlwrap
@@ -13,29 +20,66 @@ public:
   static ForeignThreadManager& instance();
   ~ForeignThreadManager();
 
+  // Switch the thread to and from GC safe mode, i.e. mark it as not running Julia code. Calls must be balanced.
   void gc_safe_enter();
   void gc_safe_leave();
+  bool is_gc_safe() const { return m_gc_safe; }
 
-  void begin_julia();
+  // The tag identifies the call site in the lock profiler statistics. The priority only matters when the lock is taken,
+  // i.e. for the outermost entry.
+  void begin_julia(const char* tag = "other", JuliaPriority priority = JuliaPriority::High);
   void end_julia();
 
+  // Release the lock and take it again, letting any waiting thread in
   void yield();
+  // Same, only if a thread with a higher priority is waiting. Cheap enough to call between each slice of background work.
+  void yield_to_higher_priority();
 
   // Remove the current instance, to be called after exec finishes.
   void cleanup();
 
+  // Pool of worker threads for asynchronous work from Qt. Its threads never expire, so each one is adopted by Julia once
+  // and the number of adopted threads is bounded by the pool size.
+  static QThreadPool& thread_pool();
+  static void set_thread_pool_size(int size);
+  // Start all threads of the pool and adopt them, so the first asynchronous call does not pay for it.
+  // The calling thread must not hold the Julia lock.
+  static void prewarm_thread_pool();
+  // Wait for the queued work and stop the pool threads, the calling thread must not hold the Julia lock
+  static void stop_thread_pool();
+  // Number of threads adopted by Julia and state of the pool
+  static QVariantMap thread_stats();
+
 private:
   ForeignThreadManager();
 
   int m_state = 0;
   int m_depth = 0;
+  // True when this thread was put in GC safe mode. Otherwise it is already running Julia code, and begin_julia
+  // neither takes the lock nor changes the GC state.
+  bool m_gc_safe = false;
+  bool m_locked = false;
+  JuliaPriority m_priority = JuliaPriority::High;
+
+  // Call site and timing of each nesting level, start is 0 when the level is not profiled
+  struct Entry
+  {
+    const char* tag = nullptr;
+    uint64_t start = 0;
+    uint64_t wait = 0;
+  };
+  std::array<Entry, LockProfiler::max_depth> m_entries;
   static thread_local ForeignThreadManager* m_instance;
-  static QMutex m_juliamutex;
+  static std::atomic<int> m_nb_adopted;
+  static QThreadPool* m_thread_pool;
+  static int m_thread_pool_size;
+  static PriorityMutex m_juliamutex;
 };
 
 struct GCGuard
 {
-  GCGuard();
+  GCGuard(const char* tag = "other");
+  GCGuard(JuliaPriority priority, const char* tag = "other");
   ~GCGuard();
 };
 
@@ -0,0 +1,202 @@
+#include "jlcxx/jlcxx.hpp"
+
+#include <chrono>
+
+#include "foreign_thread_manager.hpp"
+#include "gc_frame_guard.hpp"
+
+namespace qmlwrap
+{
+
+namespace
+{
+  struct FrameState
+  {
+    bool active = false;
+    bool gc_disabled = false;
+    // Set when the previous frame went over the deferral cap
+    bool skip_next = false;
+    uint64_t start = 0;
+    uint64_t gc_start = 0;
+  };
+  thread_local FrameState t_frame;
+
+  std::atomic<uint64_t> s_frames{0};
+  std::atomic<uint64_t> s_guarded_frames{0};
+  std::atomic<uint64_t> s_over_cap_frames{0};
+  std::atomic<uint64_t> s_overlapped_frames{0};
+  std::atomic<uint64_t> s_overlap_ns{0};
+  std::atomic<uint64_t> s_max_overlap_ns{0};
+  std::atomic<uint64_t> s_last_overlap_ns{0};
+  std::atomic<uint64_t> s_max_deferral_ns{0};
+
+  uint64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  void update_max(std::atomic<uint64_t>& current, uint64_t value)
+  {
+    uint64_t previous = current.load(std::memory_order_relaxed);
+    while(value > previous && !current.compare_exchange_weak(previous, value, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  // jl_gc_enable only needs the thread out of GC safe mode. The Julia lock is not taken, so a long call holding it
+  // can't stall rendering.
+  class GCUnsafeRegion
+  {
+  public:
+    GCUnsafeRegion() : m_manager(ForeignThreadManager::instance()), m_was_gc_safe(m_manager.is_gc_safe())
+    {
+      m_manager.gc_safe_leave();
+    }
+
+    ~GCUnsafeRegion()
+    {
+      if(m_was_gc_safe)
+      {
+        m_manager.gc_safe_enter();
+      }
+    }
+
+  private:
+    ForeignThreadManager& m_manager;
+    const bool m_was_gc_safe;
+  };
+}
+
+std::atomic<uint64_t> GCFrameGuard::m_deferral_cap_ns(100000000);
+
+GCFrameGuard::GCFrameGuard(QQuickWindow* window) : QObject(window)
+{
+  // Both signals are emitted on the render thread
+  connect(window, &QQuickWindow::beforeRendering, this, [this] ()
+  {
+    if(m_enabled.load(std::memory_order_relaxed))
+    {
+      begin_frame();
+    }
+  }, Qt::DirectConnection);
+  connect(window, &QQuickWindow::afterRendering, this, &GCFrameGuard::end_frame, Qt::DirectConnection);
+}
+
+void GCFrameGuard::attach(QQuickWindow* window)
+{
+  if(window == nullptr)
+  {
+    throw std::runtime_error("Can't attach a GC frame guard to a null window");
+  }
+  GCFrameGuard* guard = window->findChild<GCFrameGuard*>(QString(), Qt::FindDirectChildrenOnly);
+  if(guard == nullptr)
+  {
+    guard = new GCFrameGuard(window);
+  }
+  guard->m_enabled = true;
+}
+
+void GCFrameGuard::detach(QQuickWindow* window)
+{
+  // The guard stays connected, so a frame that is being rendered still enables the GC again when it ends
+  GCFrameGuard* guard = window == nullptr ? nullptr : window->findChild<GCFrameGuard*>(QString(), Qt::FindDirectChildrenOnly);
+  if(guard != nullptr)
+  {
+    guard->m_enabled = false;
+  }
+}
+
+void GCFrameGuard::begin_frame()
+{
+  FrameState& frame = t_frame;
+  if(frame.active)
+  {
+    return;
+  }
+  GCUnsafeRegion gc_unsafe;
+  frame.active = true;
+  frame.start = now();
+  // Taken first, so waiting for a collection that is already running counts as overlap
+  frame.gc_start = jl_gc_total_hrtime();
+  if(frame.skip_next)
+  {
+    frame.skip_next = false;
+    frame.gc_disabled = false;
+  }
+  else
+  {
+    // A thread that had the GC disabled already keeps it that way after the frame
+    frame.gc_disabled = jl_gc_enable(0) != 0;
+  }
+}
+
+void GCFrameGuard::end_frame()
+{
+  FrameState& frame = t_frame;
+  if(!frame.active)
+  {
+    return;
+  }
+  GCUnsafeRegion gc_unsafe;
+  const uint64_t overlap = jl_gc_total_hrtime() - frame.gc_start;
+  if(frame.gc_disabled)
+  {
+    jl_gc_enable(1);
+    const uint64_t deferral = now() - frame.start;
+    s_guarded_frames.fetch_add(1, std::memory_order_relaxed);
+    update_max(s_max_deferral_ns, deferral);
+    if(deferral > m_deferral_cap_ns.load(std::memory_order_relaxed))
+    {
+      frame.skip_next = true;
+      s_over_cap_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  frame.active = false;
+  frame.gc_disabled = false;
+
+  s_frames.fetch_add(1, std::memory_order_relaxed);
+  s_last_overlap_ns.store(overlap, std::memory_order_relaxed);
+  if(overlap != 0)
+  {
+    s_overlapped_frames.fetch_add(1, std::memory_order_relaxed);
+    s_overlap_ns.fetch_add(overlap, std::memory_order_relaxed);
+    update_max(s_max_overlap_ns, overlap);
+  }
+}
+
+void GCFrameGuard::set_max_deferral(double milliseconds)
+{
+  if(milliseconds <= 0)
+  {
+    throw std::runtime_error("Maximum GC deferral must be positive");
+  }
+  m_deferral_cap_ns = static_cast<uint64_t>(milliseconds * 1e6);
+}
+
+QVariantMap GCFrameGuard::stats()
+{
+  QVariantMap result;
+  result["frames"] = quint64(s_frames.load());
+  result["guarded_frames"] = quint64(s_guarded_frames.load());
+  result["over_cap_frames"] = quint64(s_over_cap_frames.load());
+  result["overlapped_frames"] = quint64(s_overlapped_frames.load());
+  result["overlap_ns"] = quint64(s_overlap_ns.load());
+  result["max_overlap_ns"] = quint64(s_max_overlap_ns.load());
+  result["last_overlap_ns"] = quint64(s_last_overlap_ns.load());
+  result["max_deferral_ns"] = quint64(s_max_deferral_ns.load());
+  return result;
+}
+
+void GCFrameGuard::reset_stats()
+{
+  s_frames = 0;
+  s_guarded_frames = 0;
+  s_over_cap_frames = 0;
+  s_overlapped_frames = 0;
+  s_overlap_ns = 0;
+  s_max_overlap_ns = 0;
+  s_last_overlap_ns = 0;
+  s_max_deferral_ns = 0;
+}
+
+} // namespace qmlwrap
@@ -0,0 +1,47 @@
+#ifndef QML_GC_FRAME_GUARD_H
+#define QML_GC_FRAME_GUARD_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <QObject>
+#include <QQuickWindow>
+#include <QVariantMap>
+
+namespace qmlwrap
+{
+
+/// Keeps the Julia GC from running while a frame is rendered. The GC is disabled at the start of the frame and enabled
+/// again at its end, so a collection that became due in the meantime runs in the gap between frames.
+/// Attached to a window, this happens automatically from beforeRendering to afterRendering on the render thread.
+class GCFrameGuard : public QObject
+{
+  Q_OBJECT
+public:
+  // Guard all frames rendered by the window, until it is destroyed or detach is called
+  static void attach(QQuickWindow* window);
+  static void detach(QQuickWindow* window);
+
+  // Manual use, calls must be balanced and made from the thread that renders
+  static void begin_frame();
+  static void end_frame();
+
+  // When the GC stayed disabled for longer than this during a frame, the next frame is not guarded so a pending
+  // collection can't be put off indefinitely
+  static void set_max_deferral(double milliseconds);
+
+  // Frame counts, and the GC time that overlapped guarded and unguarded frames
+  static QVariantMap stats();
+  static void reset_stats();
+
+private:
+  GCFrameGuard(QQuickWindow* window);
+
+  // Read on the render thread
+  std::atomic<bool> m_enabled{true};
+  static std::atomic<uint64_t> m_deferral_cap_ns;
+};
+
+} // namespace qmlwrap
+
+#endif
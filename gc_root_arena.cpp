@@ -0,0 +1,172 @@
+#include <utility>
+
+#include "gc_root_arena.hpp"
+#include "jlqml.hpp"
+
+namespace qmlwrap
+{
+
+GCRootArena& GCRootArena::instance()
+{
+  // Never destroyed, roots may be released during static destruction
+  static GCRootArena* arena = new GCRootArena();
+  return *arena;
+}
+
+void GCRootArena::add_slab()
+{
+  // Allocated without holding the mutex, since the allocation may wait for a collection
+  jl_array_t* roots = jl_alloc_vec_any(slab_size);
+  JL_GC_PUSH1(&roots);
+  jlcxx::protect_from_gc((jl_value_t*)roots);
+  JL_GC_POP();
+  Slab* slab = new Slab();
+  slab->roots = roots;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  SlabTable* table = m_table.load(std::memory_order_relaxed);
+  if(table == nullptr || m_nb_slabs == table->size)
+  {
+    // Slot numbers must stay below invalid_slot
+    assert(uint64_t(m_nb_slabs + 1) * slab_size < invalid_slot);
+    auto new_table = std::make_unique<SlabTable>(table == nullptr ? 16 : 2 * table->size);
+    for(uint32_t i = 0; i != m_nb_slabs; ++i)
+    {
+      new_table->slabs[i].store(table->slabs[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    table = new_table.get();
+    m_tables.push_back(std::move(new_table));
+    m_table.store(table, std::memory_order_release);
+  }
+  const uint32_t first = m_nb_slabs * slab_size;
+  table->slabs[m_nb_slabs].store(slab, std::memory_order_release);
+  ++m_nb_slabs;
+  // Reserved for all slots, so release never allocates
+  m_free_slots.reserve(m_nb_slabs * slab_size);
+  for(uint32_t i = slab_size; i != 0; --i)
+  {
+    m_free_slots.push_back(first + i - 1);
+  }
+}
+
+GCRootArena::Slab* GCRootArena::slab_of(uint32_t slot) const
+{
+  return m_table.load(std::memory_order_acquire)->slabs[slot / slab_size].load(std::memory_order_acquire);
+}
+
+uint32_t GCRootArena::acquire(jl_value_t* value, Subsystem subsystem)
+{
+  assert(value != nullptr);
+  uint32_t slot = invalid_slot;
+  while(slot == invalid_slot)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if(!m_free_slots.empty())
+      {
+        slot = m_free_slots.back();
+        m_free_slots.pop_back();
+        break;
+      }
+    }
+    // The value may be a fresh result referenced only from the C stack
+    JL_GC_PUSH1(&value);
+    add_slab();
+    JL_GC_POP();
+  }
+
+  Slab* slab = slab_of(slot);
+  const uint32_t index = slot % slab_size;
+  jl_array_ptr_set(slab->roots, index, value);
+  slab->subsystems[index] = subsystem;
+  slab->refcounts[index].store(1, std::memory_order_release);
+  m_live[int(subsystem)].fetch_add(1, std::memory_order_relaxed);
+  return slot;
+}
+
+void GCRootArena::retain(uint32_t slot)
+{
+  Slab* slab = slab_of(slot);
+  slab->refcounts[slot % slab_size].fetch_add(1, std::memory_order_relaxed);
+}
+
+void GCRootArena::release(uint32_t slot)
+{
+  Slab* slab = slab_of(slot);
+  const uint32_t index = slot % slab_size;
+  if(slab->refcounts[index].fetch_sub(1, std::memory_order_acq_rel) != 1)
+  {
+    return;
+  }
+  m_live[int(slab->subsystems[index])].fetch_sub(1, std::memory_order_relaxed);
+  // nothing is never young, so the store needs no write barrier and works from threads unknown to Julia
+  jl_value_t** data = static_cast<jl_value_t**>(julia_array_data(slab->roots));
+  reinterpret_cast<std::atomic<jl_value_t*>*>(data + index)->store(jl_nothing, std::memory_order_release);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_free_slots.push_back(slot);
+}
+
+jl_value_t* GCRootArena::value(uint32_t slot) const
+{
+  Slab* slab = slab_of(slot);
+  return jl_array_ptr_ref(slab->roots, slot % slab_size);
+}
+
+QVariantMap GCRootArena::stats() const
+{
+  static const char* subsystem_names[nb_subsystems] = {"variant", "item_model", "function", "property_map", "makie"};
+  QVariantMap live;
+  for(int i = 0; i != nb_subsystems; ++i)
+  {
+    live[subsystem_names[i]] = qlonglong(m_live[i].load(std::memory_order_relaxed));
+  }
+
+  QVariantMap result;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    result["slabs"] = m_nb_slabs;
+    result["capacity"] = qulonglong(m_nb_slabs) * slab_size;
+    result["free"] = qulonglong(m_free_slots.size());
+  }
+  result["live"] = live;
+  return result;
+}
+
+GCRoot::GCRoot(jl_value_t* value, GCRootArena::Subsystem subsystem) : m_slot(GCRootArena::instance().acquire(value, subsystem))
+{
+}
+
+GCRoot::GCRoot(const GCRoot& other) : m_slot(other.m_slot)
+{
+  if(!empty())
+  {
+    GCRootArena::instance().retain(m_slot);
+  }
+}
+
+GCRoot::GCRoot(GCRoot&& other) noexcept : m_slot(other.m_slot)
+{
+  other.m_slot = GCRootArena::invalid_slot;
+}
+
+GCRoot& GCRoot::operator=(GCRoot other) noexcept
+{
+  std::swap(m_slot, other.m_slot);
+  return *this;
+}
+
+GCRoot::~GCRoot()
+{
+  if(!empty())
+  {
+    GCRootArena::instance().release(m_slot);
+  }
+}
+
+jl_value_t* GCRoot::value() const
+{
+  return empty() ? jl_nothing : GCRootArena::instance().value(m_slot);
+}
+
+} // namespace qmlwrap
@@ -0,0 +1,101 @@
+#ifndef QML_GC_ROOT_ARENA_H
+#define QML_GC_ROOT_ARENA_H
+
+#include "jlcxx/jlcxx.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QVariantMap>
+
+namespace qmlwrap
+{
+
+/// Keeps Julia values alive on behalf of C++ objects. Values are stored in slabs, i.e. Julia Vector{Any}s that are
+/// each protected from GC once, and slots are recycled through a free list with a reference count per slot.
+class GCRootArena
+{
+public:
+  // Owner of the roots, for the live root counters
+  enum class Subsystem
+  {
+    Variant,
+    ItemModel,
+    Function,
+    PropertyMap,
+    Makie
+  };
+  static constexpr int nb_subsystems = 5;
+  static constexpr uint32_t slab_size = 1024;
+  static constexpr uint32_t invalid_slot = UINT32_MAX;
+
+  static GCRootArena& instance();
+
+  // Root the value in a free slot with a reference count of 1. The calling thread must be in Julia.
+  uint32_t acquire(jl_value_t* value, Subsystem subsystem);
+  // Reference counting and reading don't call into Julia and are allowed from any thread
+  void retain(uint32_t slot);
+  void release(uint32_t slot);
+  jl_value_t* value(uint32_t slot) const;
+
+  // Number of slabs, free slots and live roots per subsystem
+  QVariantMap stats() const;
+
+private:
+  GCRootArena() = default;
+
+  struct Slab
+  {
+    jl_array_t* roots;
+    std::atomic<int32_t> refcounts[slab_size] = {};
+    Subsystem subsystems[slab_size];
+  };
+
+  // Table of slab pointers. When it is full, it is replaced by a copy twice as large. Replaced tables are kept, since
+  // retain, release and value read the table without the mutex.
+  struct SlabTable
+  {
+    explicit SlabTable(uint32_t size) : size(size), slabs(new std::atomic<Slab*>[size]())
+    {
+    }
+    uint32_t size;
+    std::unique_ptr<std::atomic<Slab*>[]> slabs;
+  };
+
+  void add_slab();
+  Slab* slab_of(uint32_t slot) const;
+
+  std::atomic<SlabTable*> m_table{nullptr};
+  std::vector<std::unique_ptr<SlabTable>> m_tables;
+  uint32_t m_nb_slabs = 0;
+  std::vector<uint32_t> m_free_slots;
+  mutable std::mutex m_mutex;
+  std::atomic<int64_t> m_live[nb_subsystems] = {};
+};
+
+/// Reference counted handle to a value rooted in the GCRootArena. Creating a handle from a value must be done in Julia,
+/// copying and destroying handles can be done from any thread.
+class GCRoot
+{
+public:
+  GCRoot() = default;
+  GCRoot(jl_value_t* value, GCRootArena::Subsystem subsystem = GCRootArena::Subsystem::Variant);
+  GCRoot(const GCRoot& other);
+  GCRoot(GCRoot&& other) noexcept;
+  GCRoot& operator=(GCRoot other) noexcept;
+  ~GCRoot();
+
+  // The rooted value, or nothing for an empty handle
+  jl_value_t* value() const;
+  bool empty() const { return m_slot == GCRootArena::invalid_slot; }
+
+private:
+  uint32_t m_slot = GCRootArena::invalid_slot;
+};
+
+} // namespace qmlwrap
+
+#endif
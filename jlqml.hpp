@@ -4,25 +4,23 @@
 #include <jlcxx/functions.hpp>
 #include <QMetaType>
 
+#include "gc_root_arena.hpp"
+
 namespace qmlwrap
 {
 
 // Helper to store a Julia value of type Any in a GC-safe way
-struct QVariantAny
+using qvariant_any_t = GCRoot;
+
+// Pointer to the first element of a Julia array
+inline void* julia_array_data(jl_array_t* arr)
 {
-  inline QVariantAny(jl_value_t* v) : value(v)
-  {
-    assert(v != nullptr);
-    jlcxx::protect_from_gc(value);
-  }
-  inline ~QVariantAny()
-  {
-    jlcxx::unprotect_from_gc(value);
-  }
-  jl_value_t* value;
-};
-
-using qvariant_any_t = std::shared_ptr<QVariantAny>;
+#if (JULIA_VERSION_MAJOR * 100 + JULIA_VERSION_MINOR) >= 111
+  return jl_array_data(arr, void);
+#else
+  return jl_array_data(arr);
+#endif
+}
 
 }
 
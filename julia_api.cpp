@@ -1,16 +1,85 @@
+#include <algorithm>
 #include <sstream>
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
 #include <QVariantList>
 
+#include "foreign_thread_manager.hpp"
 #include "julia_api.hpp"
 #include "jlqml.hpp"
 
 namespace qmlwrap
 {
 
+namespace
+{
+  // Entries of the Julia singleton that are not registered functions
+  void check_function_name(const QString& name)
+  {
+    if(name == QLatin1String("callAsync") || name == QLatin1String("batch") || name == QLatin1String("callProfile"))
+    {
+      throw std::runtime_error(("Can't register a Julia function named " + name + ", the name is reserved").toStdString());
+    }
+  }
+}
+
+JuliaFunctionDispatcher::JuliaFunctionDispatcher(JuliaAPI* api) : QObject(api), m_api(api)
+{
+}
+
+QVariant JuliaFunctionDispatcher::call(const QString& name, const QVariantList& args)
+{
+  JuliaFunction* f = m_api->julia_function(name);
+  if(f == nullptr)
+  {
+    qWarning() << "Julia function" << name << "is not registered";
+    return QVariant();
+  }
+  return f->call(args);
+}
+
+JuliaAsyncCall* JuliaFunctionDispatcher::call_async(const QString& name, const QVariantList& args)
+{
+  JuliaFunction* f = m_api->julia_function(name);
+  if(f == nullptr)
+  {
+    qWarning() << "Julia function" << name << "is not registered";
+    return nullptr;
+  }
+  return f->call_async(args);
+}
+
+QVariantList JuliaFunctionDispatcher::call_batch(const QVariantList& calls)
+{
+  QVariantList results;
+  results.reserve(calls.size());
+  GCGuard gc_guard("JuliaAPI::batch");
+  for(const QVariant& call_value : calls)
+  {
+    QVariantList call_args = call_value.metaType() == QMetaType::fromType<QJSValue>() ? call_value.value<QJSValue>().toVariant().toList() : call_value.toList();
+    if(call_args.isEmpty())
+    {
+      qWarning() << "Empty call in Julia batch";
+      results.push_back(QVariant());
+      continue;
+    }
+    const QString name = call_args.takeFirst().toString();
+    results.push_back(call(name, call_args));
+  }
+  return results;
+}
+
+JuliaAPI::JuliaAPI() : m_dispatcher(new JuliaFunctionDispatcher(this)), m_call_profile(new QQmlPropertyMap(this)), m_call_profile_timer(new QTimer(this))
+{
+  (*this)["callProfile"] = QVariant::fromValue<QObject*>(m_call_profile);
+  m_call_profile_timer->setInterval(1000);
+  connect(m_call_profile_timer, &QTimer::timeout, this, &JuliaAPI::update_call_profile);
+}
+
 void JuliaAPI::setJuliaSignals(JuliaSignals* julia_signals)
 {
   m_julia_signals = julia_signals;
@@ -21,47 +90,221 @@ void JuliaAPI::set_js_engine(QJSEngine* e)
   m_engine = e;
   if(m_engine != nullptr)
   {
-    for(JuliaFunction* f : m_registered_functions)
+    QElapsedTimer timer;
+    timer.start();
+    QJSEngine::setObjectOwnership(m_dispatcher, QJSEngine::CppOwnership);
+    m_js_dispatcher = m_engine->newQObject(m_dispatcher);
+    // Evaluated once, each registered function only costs a call to this factory
+    m_function_factory = m_engine->evaluate("(function(dispatcher, name) { return function() { return dispatcher.call(name, arguments.length === 1 ? [arguments[0]] : Array.apply(null, arguments)); }; })");
+    // Julia.callAsync(name, args...) runs the registered function name on a worker thread
+    QJSValue call_async_factory = m_engine->evaluate("(function(dispatcher) { return function(name) { return dispatcher.call_async(name, Array.prototype.slice.call(arguments, 1)); }; })");
+    // Julia.batch([[name, args...], ...]) makes the calls and returns their results. Running arbitrary JS while in Julia
+    // would stall the garbage collection on other threads, so a function is rejected.
+    QJSValue batch_factory = m_engine->evaluate("(function(dispatcher) { return function(calls) { if(typeof calls === 'function') { throw new TypeError('Julia.batch takes a list of calls [name, args...]'); } return dispatcher.call_batch(calls); }; })");
+    if(m_function_factory.isError() || !m_function_factory.isCallable() || call_async_factory.isError() || !call_async_factory.isCallable()
+      || batch_factory.isError() || !batch_factory.isCallable())
     {
-      register_function_internal(f);
+      throw std::runtime_error("Error setting up the Julia function dispatcher");
+    }
+    (*this)["callAsync"] = call_async_factory.call({m_js_dispatcher}).toVariant(QJSValue::RetainJSObjects);
+    (*this)["batch"] = batch_factory.call({m_js_dispatcher}).toVariant(QJSValue::RetainJSObjects);
+    for(const QString& name : m_registered_functions)
+    {
+      register_function_internal(name);
     }
     m_registered_functions.clear();
+    for(JuliaTypedFunction* f : m_registered_typed_functions)
+    {
+      register_typed_function_internal(f);
+    }
+    m_registered_typed_functions.clear();
+    m_js_setup_ns += timer.nsecsElapsed();
   }
 }
 
 void JuliaAPI::register_function(const QString& name, jl_value_t* f)
 {
-  JuliaFunction* jf = new JuliaFunction(name, f, this);
+  check_function_name(name);
+  QElapsedTimer timer;
+  timer.start();
+  if(JuliaFunction* old = m_functions.take(name))
+  {
+    // Async calls that are still running outlive the function they were made on
+    for(JuliaAsyncCall* async_call : old->findChildren<JuliaAsyncCall*>(Qt::FindDirectChildrenOnly))
+    {
+      async_call->setParent(this);
+    }
+    // Unparented right away, so the function no longer appears in the call profiles
+    old->setParent(nullptr);
+    old->deleteLater();
+  }
+  m_pending_functions[name] = GCRoot(f, GCRootArena::Subsystem::Function);
+  if(m_engine == nullptr)
+  {
+    m_registered_functions.push_back(name);
+  }
+  else
+  {
+    register_function_internal(name);
+  }
+  ++m_nb_registered;
+  m_registration_ns += timer.nsecsElapsed();
+}
+
+JuliaFunction* JuliaAPI::julia_function(const QString& name)
+{
+  const auto found = m_functions.constFind(name);
+  if(found != m_functions.constEnd())
+  {
+    return *found;
+  }
+  const auto pending = m_pending_functions.constFind(name);
+  if(pending == m_pending_functions.constEnd())
+  {
+    return nullptr;
+  }
+  JuliaFunction* jf = new JuliaFunction(name, *pending, this);
+  m_pending_functions.erase(pending);
+  m_functions[name] = jf;
+  return jf;
+}
+
+QVariantMap JuliaAPI::registration_stats() const
+{
+  QVariantMap result;
+  result["registered"] = m_nb_registered;
+  result["called"] = int(m_functions.size());
+  result["registration_ns"] = m_registration_ns;
+  result["js_setup_ns"] = m_js_setup_ns;
+  return result;
+}
+
+void JuliaAPI::register_typed_function(const QString& name, jlcxx::SafeCFunction f)
+{
+  check_function_name(name);
+  for(JuliaTypedFunction* old : findChildren<JuliaTypedFunction*>(Qt::FindDirectChildrenOnly))
+  {
+    if(old->name() == name)
+    {
+      m_registered_typed_functions.erase(std::remove(m_registered_typed_functions.begin(), m_registered_typed_functions.end(), old), m_registered_typed_functions.end());
+      old->setParent(nullptr);
+      old->deleteLater();
+    }
+  }
+  JuliaTypedFunction* jf = new JuliaTypedFunction(name, f, this);
   if(m_engine == nullptr)
   {
-    m_registered_functions.push_back(jf);
+    m_registered_typed_functions.push_back(jf);
   }
   else
   {
-    register_function_internal(jf);
+    register_typed_function_internal(jf);
   }
 }
 
-JuliaAPI::~JuliaAPI()
+void JuliaAPI::set_call_profiling(bool enabled)
 {
+  CallProfile::set_enabled(enabled);
+  if(enabled)
+  {
+    m_call_profile_timer->start();
+  }
+  else
+  {
+    m_call_profile_timer->stop();
+    update_call_profile();
+  }
+}
+
+template<typename F>
+void JuliaAPI::for_each_profile(F&& f) const
+{
+  for(JuliaFunction* jf : findChildren<JuliaFunction*>(Qt::FindDirectChildrenOnly))
+  {
+    f(jf->name(), jf->profile());
+  }
+  for(JuliaTypedFunction* jf : findChildren<JuliaTypedFunction*>(Qt::FindDirectChildrenOnly))
+  {
+    f(jf->name(), jf->profile());
+  }
+}
+
+QVariantList JuliaAPI::call_profile() const
+{
+  QVariantList result;
+  for_each_profile([&result] (const QString& name, const CallProfile& profile)
+  {
+    QVariantMap stats = profile.stats();
+    if(stats["count"].toULongLong() == 0)
+    {
+      return;
+    }
+    stats["name"] = name;
+    result.push_back(stats);
+  });
+  return result;
 }
 
-void JuliaAPI::register_function_internal(JuliaFunction* jf)
+void JuliaAPI::reset_call_profile()
+{
+  for_each_profile([] (const QString&, CallProfile& profile)
+  {
+    profile.reset();
+  });
+  update_call_profile();
+}
+
+void JuliaAPI::update_call_profile()
+{
+  for_each_profile([this] (const QString& name, const CallProfile& profile)
+  {
+    m_call_profile->insert(name, profile.stats());
+  });
+}
+
+void JuliaAPI::register_function_internal(const QString& name)
+{
+  if(m_engine == nullptr)
+  {
+    throw std::runtime_error("No JS engine, can't register function");
+  }
+
+  QJSValue f = m_function_factory.call({m_js_dispatcher, QJSValue(name)});
+  if(f.isError() || !f.isCallable())
+  {
+    throw std::runtime_error(("Error setting function" + name).toStdString());
+  }
+  (*this)[name] = f.toVariant(QJSValue::RetainJSObjects);
+}
+
+void JuliaAPI::register_typed_function_internal(JuliaTypedFunction* jf)
 {
   if(m_engine == nullptr)
   {
     throw std::runtime_error("No JS engine, can't register function");
   }
 
-  QJSValue f = m_engine->evaluate("(function() { return this." + jf->name() + ".julia_function.call(arguments.length === 1 ? [arguments[0]] : Array.apply(null, arguments)); })");
+  // The wrapper has the exact arity, so the arguments are passed on without building an array
+  QStringList args;
+  for(int i = 0; i != jf->nb_arguments(); ++i)
+  {
+    args.push_back("a" + QString::number(i));
+  }
+  const QString arglist = args.join(", ");
+  set_js_function(jf->name(), "(function(" + arglist + ") { return this." + jf->name() + ".julia_function.call" + QString::number(jf->nb_arguments()) + "(" + arglist + "); })", jf);
+}
+
+void JuliaAPI::set_js_function(const QString& name, const QString& source, QObject* julia_function)
+{
+  QJSValue f = m_engine->evaluate(source);
 
   if(f.isError() || !f.isCallable())
   {
-    throw std::runtime_error(("Error setting function" + jf->name()).toStdString());
+    throw std::runtime_error(("Error setting function" + name).toStdString());
   }
 
-  f.setProperty("julia_function", m_engine->newQObject(jf));
-  (*this)[jf->name()] = f.toVariant(QJSValue::RetainJSObjects);
+  f.setProperty("julia_function", m_engine->newQObject(julia_function));
+  (*this)[name] = f.toVariant(QJSValue::RetainJSObjects);
 }
 
 JuliaAPI* JuliaSingleton::create(QQmlEngine* qmlEngine, QJSEngine* scriptEngine)
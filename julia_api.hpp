@@ -3,22 +3,44 @@
 
 #include <vector>
 
+#include <QHash>
 #include <QJSValue>
 #include <QQmlEngine>
 #include <QQmlPropertyMap>
+#include <QTimer>
 #include <QVariant>
 
 #include "julia_function.hpp"
 #include "julia_signals.hpp"
+#include "julia_typed_function.hpp"
 
 namespace qmlwrap
 {
 
+class JuliaAPI;
+
+/// Single object through which QML calls all functions registered with qmlfunction
+class JuliaFunctionDispatcher : public QObject
+{
+  Q_OBJECT
+public:
+  JuliaFunctionDispatcher(JuliaAPI* api);
+
+  Q_INVOKABLE QVariant call(const QString& name, const QVariantList& args);
+  Q_INVOKABLE qmlwrap::JuliaAsyncCall* call_async(const QString& name, const QVariantList& args);
+  // Make all the calls, each a list of the function name followed by the arguments, while entering Julia only once
+  Q_INVOKABLE QVariantList call_batch(const QVariantList& calls);
+
+private:
+  JuliaAPI* m_api;
+};
+
 /// Global API, allowing to call Julia functions from QML
 class JuliaAPI : public QQmlPropertyMap
 {
   Q_OBJECT
 public:
+  JuliaAPI();
 
   JuliaSignals* juliaSignals() const
   {
@@ -30,14 +52,46 @@ public:
   void set_js_engine(QJSEngine* e);
 
   void register_function(const QString& name, jl_value_t* f);
-
-  ~JuliaAPI();
+  // Function registered under the given name, created on its first call. Returns nullptr for an unknown name.
+  JuliaFunction* julia_function(const QString& name);
+  // Number of registered functions, how many of them were called, and the time spent registering them
+  QVariantMap registration_stats() const;
+  // Register a function with the signature of its cfunction, calling it skips the conversions through a list
+  void register_typed_function(const QString& name, jlcxx::SafeCFunction f);
+
+  // Profile the calls to the registered functions. The callProfile map of the singleton is refreshed every second
+  // while profiling is enabled.
+  void set_call_profiling(bool enabled);
+  // One map per registered function that was called, with its name and call statistics
+  QVariantList call_profile() const;
+  void reset_call_profile();
 
 private:
+  void update_call_profile();
+  // Calls f with the name and profile of each function and typed function
+  template<typename F>
+  void for_each_profile(F&& f) const;
+
   JuliaSignals* m_julia_signals = nullptr;
-  void register_function_internal(JuliaFunction* f);
+  void register_function_internal(const QString& name);
+  void register_typed_function_internal(JuliaTypedFunction* f);
+  void set_js_function(const QString& name, const QString& source, QObject* julia_function);
   QJSEngine* m_engine = nullptr;
-  std::vector<JuliaFunction*> m_registered_functions;
+  // Names waiting for the JS engine
+  std::vector<QString> m_registered_functions;
+  // Registered functions that were not called yet
+  QHash<QString, GCRoot> m_pending_functions;
+  QHash<QString, JuliaFunction*> m_functions;
+  JuliaFunctionDispatcher* m_dispatcher;
+  // JS function creating the QML callable for a name, shared by all registered functions
+  QJSValue m_function_factory;
+  QJSValue m_js_dispatcher;
+  int m_nb_registered = 0;
+  qint64 m_registration_ns = 0;
+  qint64 m_js_setup_ns = 0;
+  std::vector<JuliaTypedFunction*> m_registered_typed_functions;
+  QQmlPropertyMap* m_call_profile;
+  QTimer* m_call_profile_timer;
 };
 
 struct JuliaSingleton
@@ -0,0 +1,91 @@
+#include <cstring>
+
+#include "foreign_thread_manager.hpp"
+#include "julia_array.hpp"
+
+namespace qmlwrap
+{
+
+namespace
+{
+  void check_element_type(jl_value_t* eltype)
+  {
+    if(!jl_is_datatype(eltype) || !jl_is_primitivetype(eltype))
+    {
+      throw std::runtime_error("JuliaArray elements must be of a primitive type, like Float64 or Int32");
+    }
+  }
+}
+
+JuliaArray::JuliaArray(jl_value_t* array)
+{
+  if(!jl_is_array(array))
+  {
+    throw std::runtime_error("JuliaArray must be constructed from an Array");
+  }
+  jl_value_t* eltype = jl_tparam0(jl_typeof(array));
+  check_element_type(eltype);
+
+  m_array = qvariant_any_t(array);
+  m_element_size = int(jl_datatype_size(eltype));
+  m_element_type = QString::fromUtf8(jl_typename_str(eltype));
+}
+
+QByteArray JuliaArray::buffer() const
+{
+  if(m_array.empty())
+  {
+    return QByteArray();
+  }
+  GCGuard gc_guard("JuliaArray::buffer");
+  jl_array_t* arr = reinterpret_cast<jl_array_t*>(m_array.value());
+  return QByteArray(static_cast<const char*>(julia_array_data(arr)), qsizetype(jl_array_len(arr)) * m_element_size);
+}
+
+int JuliaArray::length() const
+{
+  if(m_array.empty())
+  {
+    return 0;
+  }
+  GCGuard gc_guard("JuliaArray::length");
+  return int(jl_array_len(reinterpret_cast<jl_array_t*>(m_array.value())));
+}
+
+QVariantList JuliaArray::dims() const
+{
+  QVariantList result;
+  if(m_array.empty())
+  {
+    return result;
+  }
+  GCGuard gc_guard("JuliaArray::dims");
+  jl_array_t* arr = reinterpret_cast<jl_array_t*>(m_array.value());
+  const int ndims = int(jl_array_ndims(arr));
+  for(int i = 0; i != ndims; ++i)
+  {
+    result.push_back(qlonglong(jl_array_dim(arr, i)));
+  }
+  return result;
+}
+
+jl_value_t* JuliaArray::julia_array() const
+{
+  return m_array.value();
+}
+
+jl_value_t* JuliaArray::from_bytes(const QByteArray& bytes, jl_datatype_t* eltype)
+{
+  check_element_type((jl_value_t*)eltype);
+  const size_t element_size = jl_datatype_size(eltype);
+  if(bytes.size() % element_size != 0)
+  {
+    throw std::runtime_error("Byte array size is not a multiple of the element size");
+  }
+  const size_t length = bytes.size() / element_size;
+  jl_array_t* arr = jl_alloc_array_1d(jl_apply_array_type((jl_value_t*)eltype, 1), length);
+  std::memcpy(julia_array_data(arr), bytes.constData(), bytes.size());
+  return (jl_value_t*)arr;
+}
+
+} // namespace qmlwrap
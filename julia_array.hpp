@@ -0,0 +1,53 @@
+#ifndef QML_JULIA_ARRAY_H
+#define QML_JULIA_ARRAY_H
+
+#include "jlcxx/jlcxx.hpp"
+
+#include <QByteArray>
+#include <QObject>
+#include <QQmlEngine>
+#include <QString>
+#include <QVariantList>
+
+#include "jlqml.hpp"
+
+namespace qmlwrap
+{
+
+/// Julia array of a primitive element type passed to QML as a whole instead of as a list with one QVariant per element.
+/// QML reads the elements through buffer, e.g. new Float64Array(a.buffer). The array is kept alive while this value exists.
+class JuliaArray
+{
+  Q_GADGET
+  QML_ANONYMOUS
+  Q_PROPERTY(QByteArray buffer READ buffer)
+  Q_PROPERTY(int length READ length)
+  Q_PROPERTY(QString elementType READ element_type)
+  Q_PROPERTY(QVariantList dims READ dims)
+public:
+  JuliaArray() = default;
+  JuliaArray(jl_value_t* array);
+
+  // Copy of the elements, in a single block. Becomes an ArrayBuffer in QML.
+  // The size and data are read from the array on each call, since Julia may resize it.
+  QByteArray buffer() const;
+  int length() const;
+  QString element_type() const { return m_element_type; }
+  QVariantList dims() const;
+
+  jl_value_t* julia_array() const;
+
+  // New Julia Vector with the given element type holding a copy of the bytes, e.g. from an ArrayBuffer sent by QML
+  static jl_value_t* from_bytes(const QByteArray& bytes, jl_datatype_t* eltype);
+
+private:
+  qvariant_any_t m_array;
+  int m_element_size = 0;
+  QString m_element_type;
+};
+
+} // namespace qmlwrap
+
+Q_DECLARE_METATYPE(qmlwrap::JuliaArray)
+
+#endif
@@ -0,0 +1,47 @@
+#include "julia_async_call.hpp"
+
+namespace qmlwrap
+{
+
+JuliaAsyncCall::JuliaAsyncCall(QObject* parent) : QObject(parent), m_cancelled(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+void JuliaAsyncCall::cancel()
+{
+  if(!m_running)
+  {
+    return;
+  }
+  *m_cancelled = true;
+  m_running = false;
+  emit runningChanged();
+}
+
+void JuliaAsyncCall::deliver_result(const QVariant& result)
+{
+  if(!*m_cancelled)
+  {
+    set_done();
+    emit finished(result);
+  }
+  deleteLater();
+}
+
+void JuliaAsyncCall::deliver_error(const QString& error)
+{
+  if(!*m_cancelled)
+  {
+    set_done();
+    emit failed(error);
+  }
+  deleteLater();
+}
+
+void JuliaAsyncCall::set_done()
+{
+  m_running = false;
+  emit runningChanged();
+}
+
+} // namespace qmlwrap
@@ -0,0 +1,49 @@
+#ifndef QML_JULIA_ASYNC_CALL_H
+#define QML_JULIA_ASYNC_CALL_H
+
+#include <atomic>
+#include <memory>
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+
+namespace qmlwrap
+{
+
+/// Result of a Julia function call running on a worker thread, returned to QML by Julia.callAsync.
+/// Exactly one of finished or failed is emitted on the GUI thread, unless the call is cancelled first.
+/// The object deletes itself once the call is done.
+class JuliaAsyncCall : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+public:
+  JuliaAsyncCall(QObject* parent = nullptr);
+
+  bool running() const { return m_running; }
+
+  // A call that did not start yet is skipped. A running call can't be interrupted, but its result is discarded.
+  Q_INVOKABLE void cancel();
+
+  // Shared with the worker, which checks it before starting
+  std::shared_ptr<std::atomic<bool>> cancel_token() const { return m_cancelled; }
+
+  void deliver_result(const QVariant& result);
+  void deliver_error(const QString& error);
+
+signals:
+  void finished(const QVariant& result);
+  void failed(const QString& error);
+  void runningChanged();
+
+private:
+  void set_done();
+
+  bool m_running = true;
+  std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+} // namespace qmlwrap
+
+#endif
@@ -22,7 +22,7 @@ void JuliaCanvas::paint(QPainter *painter)
 
   // call julia painter
   {
-    GCGuard gc_guard;
+    GCGuard gc_guard("JuliaCanvas::paint");
     m_callback(draw_buffer, iwidth, iheight);
   }
 
@@ -1,31 +1,195 @@
+#include <QCoreApplication>
 #include <QDebug>
+#include <QPointer>
+#include <QVariantMap>
 
 #include "julia_function.hpp"
 #include "jlqml.hpp"
 #include "foreign_thread_manager.hpp"
+#include "lock_profiler.hpp"
+#include "string_conversion.hpp"
 
 namespace qmlwrap
 {
 
+namespace
+{
+  using call_julia_func_t = void* (*) (jl_value_t*, const void*);
+
+  call_julia_func_t julia_call_func()
+  {
+    static call_julia_func_t call_func = reinterpret_cast<call_julia_func_t>(jlcxx::unbox<void*>(jlcxx::JuliaFunction(jl_get_function(JuliaFunction::m_qml_mod, "get_julia_call"))()));
+    return call_func;
+  }
+
+  // Call f with the arguments converted by the Julia side. The result is owned by Julia, so the caller must hold a
+  // GCGuard until it is copied.
+  const QVariant& call_julia(jl_value_t* f, const QVariantList& args)
+  {
+    return *reinterpret_cast<QVariant*>(julia_call_func()(f, &args));
+  }
+
+  // Message of a Julia exception, as printed by showerror
+  QString exception_message(jl_value_t* exception)
+  {
+    static jl_function_t* sprint = jl_get_function(jl_base_module, "sprint");
+    static jl_function_t* showerror = jl_get_function(jl_base_module, "showerror");
+    jl_value_t* text = jl_call2(sprint, showerror, exception);
+    if(text == nullptr || !jl_is_string(text))
+    {
+      return QStringLiteral("Julia exception in Julia.callAsync");
+    }
+    return julia_to_qstring(text);
+  }
+
+  // Same as call_julia, but a Julia exception is caught and its message stored in error instead of unwinding the
+  // calling thread, which may have no Julia exception handler. Returns nullptr in that case. No C++ object may be
+  // created inside JL_TRY, since the exception is a longjmp. The exception stays rooted until the end of JL_CATCH.
+  const QVariant* try_call_julia(jl_value_t* f, const QVariantList& args, QString& error)
+  {
+    call_julia_func_t call_func = julia_call_func();
+    const QVariant* result = nullptr;
+    JL_TRY
+    {
+      result = reinterpret_cast<const QVariant*>(call_func(f, &args));
+    }
+    JL_CATCH
+    {
+      #if (JULIA_VERSION_MAJOR * 100 + JULIA_VERSION_MINOR) >= 110
+      error = exception_message(jl_current_exception(jl_current_task));
+      #else
+      error = exception_message(jl_current_exception());
+      #endif
+      result = nullptr;
+    }
+    return result;
+  }
+
+  // Copy of v that can be used on a worker thread. JS values are converted here, on the thread of their engine, and
+  // QObjects are refused since they may only be accessed from their own thread. Returns false on a QObject.
+  bool to_plain_value(const QVariant& v, QVariant& result)
+  {
+    if(v.userType() == qMetaTypeId<QJSValue>())
+    {
+      return to_plain_value(v.value<QJSValue>().toVariant(), result);
+    }
+    if(v.metaType().flags().testFlag(QMetaType::PointerToQObject))
+    {
+      return false;
+    }
+    if(v.userType() == QMetaType::QVariantList)
+    {
+      QVariantList list = v.toList();
+      for(QVariant& element : list)
+      {
+        if(!to_plain_value(element, element))
+        {
+          return false;
+        }
+      }
+      result = list;
+      return true;
+    }
+    if(v.userType() == QMetaType::QVariantMap)
+    {
+      QVariantMap map = v.toMap();
+      for(QVariant& element : map)
+      {
+        if(!to_plain_value(element, element))
+        {
+          return false;
+        }
+      }
+      result = map;
+      return true;
+    }
+    result = v;
+    return true;
+  }
+}
+
 jl_module_t* JuliaFunction::m_qml_mod = nullptr;
 
-JuliaFunction::JuliaFunction(const QString& name, jl_value_t* f, QObject* parent) : QObject(parent), m_name(name), m_f(f)
+// Only copies the handle, so functions can be created on the GUI thread without entering Julia
+JuliaFunction::JuliaFunction(const QString& name, const GCRoot& f, QObject* parent) : QObject(parent), m_name(name), m_f(f), m_profile(std::make_shared<CallProfile>())
 {
-  jlcxx::protect_from_gc(m_f);
 }
 
-JuliaFunction::~JuliaFunction()
+QVariant JuliaFunction::call(const QVariantList& args)
 {
-  jlcxx::unprotect_from_gc(m_f);
+  CallProfile::Timer timer(*m_profile);
+  GCGuard gc_guard("JuliaFunction::call");
+  timer.entered();
+  return call_julia(m_f.value(), args);
 }
 
-QVariant JuliaFunction::call(const QVariantList& args)
+JuliaAsyncCall* JuliaFunction::call_async(const QVariantList& args)
 {
-  GCGuard gc_guard;
-  using call_julia_func_t = void* (*) (jl_value_t*, const void*);
-  static call_julia_func_t call_func = reinterpret_cast<call_julia_func_t>(jlcxx::unbox<void*>(jlcxx::JuliaFunction(jl_get_function(m_qml_mod, "get_julia_call"))()));
-  QVariant result_var = *reinterpret_cast<QVariant*>(call_func(m_f, &args));
-  return result_var;
+  // Parented to the function, so QML does not collect it while the call runs
+  JuliaAsyncCall* async_call = new JuliaAsyncCall(this);
+  QPointer<JuliaAsyncCall> target(async_call);
+  std::shared_ptr<std::atomic<bool>> cancelled = async_call->cancel_token();
+  const uint64_t conversion_start = CallProfile::enabled() ? LockProfiler::now() : 0;
+  QVariantList plain_args;
+  plain_args.reserve(args.size());
+  for(const QVariant& arg : args)
+  {
+    QVariant plain_arg;
+    if(!to_plain_value(arg, plain_arg))
+    {
+      // Queued, so the caller can connect to failed first
+      QMetaObject::invokeMethod(async_call, [target] ()
+      {
+        if(!target.isNull())
+        {
+          target->deliver_error("QObject arguments can't be passed to Julia.callAsync");
+        }
+      }, Qt::QueuedConnection);
+      return async_call;
+    }
+    plain_args.push_back(plain_arg);
+  }
+  const uint64_t conversion_ns = conversion_start != 0 ? LockProfiler::now() - conversion_start : 0;
+  ForeignThreadManager::thread_pool().start([f = m_f, profile = m_profile, args = std::move(plain_args), conversion_ns, target, cancelled] ()
+  {
+    QVariant result;
+    QString error;
+    if(!*cancelled)
+    {
+      try
+      {
+        CallProfile::Timer timer(*profile);
+        CallProfile::add_conversion_time(conversion_ns);
+        GCGuard gc_guard(JuliaPriority::Normal, "JuliaFunction::call_async");
+        timer.entered();
+        const QVariant* call_result = try_call_julia(f.value(), args, error);
+        if(call_result != nullptr)
+        {
+          result = *call_result;
+        }
+      }
+      catch(const std::exception& e)
+      {
+        error = QString::fromUtf8(e.what());
+      }
+    }
+    QMetaObject::invokeMethod(QCoreApplication::instance(), [target, result, error] ()
+    {
+      if(target.isNull())
+      {
+        return;
+      }
+      if(error.isEmpty())
+      {
+        target->deliver_result(result);
+      }
+      else
+      {
+        target->deliver_error(error);
+      }
+    }, Qt::QueuedConnection);
+  });
+  return async_call;
 }
 
 
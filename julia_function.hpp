@@ -3,11 +3,17 @@
 
 #include "jlcxx/jlcxx.hpp"
 
+#include <memory>
+
 #include <QJSValue>
 #include <QObject>
 #include <QQmlEngine>
 #include <QVariant>
 
+#include "call_profile.hpp"
+#include "gc_root_arena.hpp"
+#include "julia_async_call.hpp"
+
 namespace qmlwrap
 {
 
@@ -18,18 +24,23 @@ class JuliaFunction : public QObject
 public:
   static jl_module_t* m_qml_mod;
 
-  JuliaFunction(const QString& name, jl_value_t* f, QObject* parent);
+  JuliaFunction(const QString& name, const GCRoot& f, QObject* parent);
 
   // Call a Julia function that takes any number of arguments as a list
   Q_INVOKABLE QVariant call(const QVariantList& arg);
-
-  ~JuliaFunction();
+  // Same as call, but running on a thread from the pool of adopted threads. The result is delivered on the GUI thread
+  // through the signals of the returned object.
+  Q_INVOKABLE qmlwrap::JuliaAsyncCall* call_async(const QVariantList& args);
 
   const QString& name() { return m_name; }
+  // Timing of the calls made through call and call_async, filled in while profiling is enabled
+  CallProfile& profile() { return *m_profile; }
 
 private:
   QString m_name;
-  jl_value_t* m_f;
+  GCRoot m_f;
+  // Shared with running async calls
+  std::shared_ptr<CallProfile> m_profile;
 };
 
 } // namespace qmlwrap
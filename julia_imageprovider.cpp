@@ -20,7 +20,7 @@ inline ImageT process_request(JuliaImageProvider::callback_t f, const QString &i
     throw std::runtime_error("No callback function set for JuliaImageProvider");
   }
   
-  GCGuard gc_guard;
+  GCGuard gc_guard("JuliaImageProvider::request");
   ImageResult<ImageT> response = jlcxx::unbox<ImageResult<ImageT>>(f(id, requestedSize.width(), requestedSize.height()));
   *size = response.m_size;
   return std::move(response.m_image);
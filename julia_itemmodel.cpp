@@ -1,23 +1,43 @@
 #include "julia_itemmodel.hpp"
 #include "foreign_thread_manager.hpp"
+#include "jlqml.hpp"
+#include "row_diff.hpp"
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include <QDebug>
 #include <QVariant>
 
 namespace qmlwrap
 {
 
+namespace
+{
+  // Maximum number of cached values, summed over all tiles
+  constexpr qsizetype max_cached_values = 1 << 20;
+
+  // Above this number of pending ranges, they are merged into a single bounding rectangle
+  constexpr std::size_t max_pending_changes = 16;
+
+  // Changes waiting for a frame are flushed after this delay if no frame comes, e.g. for a hidden window
+  constexpr int frame_flush_timeout_ms = 100;
+
+  inline quint64 tile_key(int tile_row, int tile_column)
+  {
+    return (quint64(quint32(tile_row)) << 32) | quint32(tile_column);
+  }
+}
+
 jl_module_t* JuliaItemModel::m_qml_mod = nullptr;
 
-JuliaItemModel::JuliaItemModel(jl_value_t* data, QObject* parent) : QAbstractTableModel(parent), m_data(data)
+JuliaItemModel::JuliaItemModel(jl_value_t* data, QObject* parent) : QAbstractTableModel(parent), m_data(data), m_data_root(data, GCRootArena::Subsystem::ItemModel), m_tiles(max_cached_values)
 {
   assert(m_qml_mod != nullptr);
-  jlcxx::protect_from_gc(m_data);
 }
 
-JuliaItemModel::~JuliaItemModel()
-{
-  jlcxx::unprotect_from_gc(m_data);
-}
+JuliaItemModel::~JuliaItemModel() = default;
 
 template<typename ReturnT>
 auto safe_unbox(jl_value_t* arg)
@@ -41,24 +61,50 @@ auto safe_unbox<QVariant&>(jl_value_t* arg)
 
 int JuliaItemModel::rowCount(const QModelIndex& parent) const
 {
+  if(m_row_count >= 0)
+  {
+    ++m_count_cache_hits;
+    return m_row_count;
+  }
   GCGuard gc_guard;
   static const jlcxx::JuliaFunction rowcount(jl_get_function(m_qml_mod, "rowcount"));
-  return safe_unbox<int>(rowcount(m_data));
+  m_row_count = safe_unbox<int>(rowcount(m_data));
+  return m_row_count;
 }
 
 int JuliaItemModel::columnCount(const QModelIndex& parent) const
 {
+  if(m_column_count >= 0)
+  {
+    ++m_count_cache_hits;
+    return m_column_count;
+  }
   GCGuard gc_guard;
   static const jlcxx::JuliaFunction colcount(jl_get_function(m_qml_mod, "colcount"));
-  return safe_unbox<int>(colcount(m_data));
+  m_column_count = safe_unbox<int>(colcount(m_data));
+  return m_column_count;
 }
 
 QVariant JuliaItemModel::data(const QModelIndex& index, int role) const
 {
-  GCGuard gc_guard;
-  static const jlcxx::JuliaFunction data_f(jl_get_function(m_qml_mod, "data"));
-  // The static cast avoids sending a reference to the Julia function, which would require adding an extra method
-  return safe_unbox<QVariant&>(data_f(m_data, static_cast<int>(role), index.row()+1, index.column()+1));
+  if(index.isValid())
+  {
+    prefetch(index.row());
+    if((role == Qt::DisplayRole || role == Qt::EditRole) && index.column() < int(m_native_columns.size()))
+    {
+      const NativeColumn& column = m_native_columns[index.column()];
+      if(!column.array.empty() && index.row() < column.length)
+      {
+        return column.value(index.row());
+      }
+    }
+    if(const QVariant* cached = cached_data(index.row(), index.column(), role))
+    {
+      return *cached;
+    }
+  }
+  GCGuard gc_guard("JuliaItemModel::data");
+  return fetch_data(index.row(), index.column(), role);
 }
 
 QVariant JuliaItemModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -72,7 +118,9 @@ bool JuliaItemModel::setData(const QModelIndex& index, const QVariant& value, in
 {
   GCGuard gc_guard;
   static const jlcxx::JuliaFunction setdata(jl_get_function(m_qml_mod, "setdata!"));
-  return safe_unbox<bool>(setdata(this, value, static_cast<int>(role), index.row()+1, index.column()+1));
+  const bool result = safe_unbox<bool>(setdata(this, value, static_cast<int>(role), index.row()+1, index.column()+1));
+  invalidate_tiles(index.row()+1, index.column()+1, index.row()+1, index.column()+1);
+  return result;
 }
 
 bool JuliaItemModel::setHeaderData(int section, Qt::Orientation orientation, const QVariant& value, int role)
@@ -92,9 +140,37 @@ Qt::ItemFlags JuliaItemModel::flags(const QModelIndex& index) const
 
 QHash<int, QByteArray> JuliaItemModel::roleNames() const
 {
+  if(!m_role_names_valid)
+  {
+    GCGuard gc_guard;
+    static const jlcxx::JuliaFunction rolenames(jl_get_function(m_qml_mod, "rolenames"));
+    m_role_names = safe_unbox<QHash<int, QByteArray>>(rolenames(m_data));
+    m_role_names_valid = true;
+  }
+  return m_role_names;
+}
+
+bool JuliaItemModel::canFetchMore(const QModelIndex& parent) const
+{
+  if(parent.isValid() || m_fetch_chunk_size <= 0)
+  {
+    return false;
+  }
   GCGuard gc_guard;
-  static const jlcxx::JuliaFunction rolenames(jl_get_function(m_qml_mod, "rolenames"));
-  return safe_unbox<QHash<int, QByteArray>>(rolenames(m_data));
+  static const jlcxx::JuliaFunction can_fetch_more(jl_get_function(m_qml_mod, "can_fetch_more"));
+  return safe_unbox<bool>(can_fetch_more(m_data));
+}
+
+void JuliaItemModel::fetchMore(const QModelIndex& parent)
+{
+  m_fetch_queued = false;
+  if(parent.isValid() || m_fetch_chunk_size <= 0)
+  {
+    return;
+  }
+  GCGuard gc_guard;
+  static const jlcxx::JuliaFunction fetch_more(jl_get_function(m_qml_mod, "fetch_more!"));
+  fetch_more(this, static_cast<int>(m_fetch_chunk_size));
 }
 
 void JuliaItemModel::clear()
@@ -176,6 +252,13 @@ void JuliaItemModel::setColumn(int columnIndex, const QVariant& column)
 
 void JuliaItemModel::emit_data_changed(int startrow, int startcol, int endrow, int endcol)
 {
+  refresh_native_columns();
+  invalidate_tiles(startrow, startcol, endrow, endcol);
+  if(m_batch_updates)
+  {
+    queue_data_changed(QRect(QPoint(startcol-1, startrow-1), QPoint(endcol-1, endrow-1)));
+    return;
+  }
   emit dataChanged(createIndex(startrow-1, startcol-1), createIndex(endrow-1, endcol-1));
 }
 
@@ -186,26 +269,34 @@ void JuliaItemModel::emit_header_data_changed(Qt::Orientation orientation, int f
 
 void JuliaItemModel::begin_reset_model()
 {
+  flush_data_changes();
   beginResetModel();
 }
 
 void JuliaItemModel::end_reset_model()
 {
+  m_role_names_valid = false;
+  m_tile_roles.clear();
+  invalidate_caches();
   endResetModel();
 }
 
 void JuliaItemModel::begin_insert_rows(int first, int last)
 {
+  flush_data_changes();
+  m_changed_first_row = first;
   beginInsertRows(QModelIndex(), first-1, last-1);
 }
 
 void JuliaItemModel::end_insert_rows()
 {
+  invalidate_rows_from(m_changed_first_row);
   endInsertRows();
 }
 
 bool JuliaItemModel::begin_move_rows(int fromIndex, int toIndex, int count)
 {
+  flush_data_changes();
   fromIndex -= 1;
   toIndex -= 1;
   return beginMoveRows(QModelIndex(), fromIndex, fromIndex+count-1, QModelIndex(), toIndex > fromIndex ? toIndex + count : toIndex);
@@ -213,31 +304,38 @@ bool JuliaItemModel::begin_move_rows(int fromIndex, int toIndex, int count)
 
 void JuliaItemModel::end_move_rows()
 {
+  invalidate_caches();
   endMoveRows();
 }
 
 void JuliaItemModel::begin_remove_rows(int fromIndex, int count)
 {
+  flush_data_changes();
+  m_changed_first_row = fromIndex;
   beginRemoveRows(QModelIndex(), fromIndex-1, fromIndex+count-2);
 }
 
 void JuliaItemModel::end_remove_rows()
 {
+  invalidate_rows_from(m_changed_first_row);
   endRemoveRows();
 }
 
 void JuliaItemModel::begin_insert_columns(int first, int last)
 {
+  flush_data_changes();
   beginInsertColumns(QModelIndex(), first-1, last-1);
 }
 
 void JuliaItemModel::end_insert_columns()
 {
+  invalidate_caches();
   endInsertColumns();
 }
 
 bool JuliaItemModel::begin_move_columns(int fromIndex, int toIndex, int count)
 {
+  flush_data_changes();
   fromIndex -= 1;
   toIndex -= 1;
   return beginMoveColumns(QModelIndex(), fromIndex, fromIndex+count-1, QModelIndex(), toIndex > fromIndex ? toIndex + count : toIndex);
@@ -245,16 +343,19 @@ bool JuliaItemModel::begin_move_columns(int fromIndex, int toIndex, int count)
 
 void JuliaItemModel::end_move_columns()
 {
+  invalidate_caches();
   endMoveColumns();
 }
 
 void JuliaItemModel::begin_remove_columns(int fromIndex, int count)
 {
+  flush_data_changes();
   beginRemoveColumns(QModelIndex(), fromIndex-1, fromIndex+count-2);
 }
 
 void JuliaItemModel::end_remove_columns()
 {
+  invalidate_caches();
   endRemoveColumns();
 }
 
@@ -268,4 +369,549 @@ jl_value_t* JuliaItemModel::get_julia_data() const
   return m_data;
 }
 
+uint64_t JuliaItemModel::count_cache_hits() const
+{
+  return m_count_cache_hits;
+}
+
+void JuliaItemModel::set_tile_size(int rows, int columns)
+{
+  m_tile_rows = rows;
+  m_tile_columns = columns;
+  m_tiles.clear();
+}
+
+uint64_t JuliaItemModel::tile_cache_misses() const
+{
+  return m_tile_cache_misses;
+}
+
+void JuliaItemModel::set_role_getter(int role, jlcxx::SafeCFunction getter)
+{
+  m_role_getters[role] = jlcxx::make_function_pointer<jl_value_t*(jl_value_t*, int, int)>(getter);
+  m_tiles.clear();
+}
+
+void JuliaItemModel::clear_role_getters()
+{
+  m_role_getters.clear();
+  m_tiles.clear();
+}
+
+QVariant JuliaItemModel::fetch_data(int row, int column, int role) const
+{
+  const auto getter = m_role_getters.constFind(role);
+  if(getter != m_role_getters.constEnd())
+  {
+    return safe_unbox<QVariant&>((*getter)(m_data, row+1, column+1));
+  }
+  static const jlcxx::JuliaFunction data_f(jl_get_function(m_qml_mod, "data"));
+  // The static cast avoids sending a reference to the Julia function, which would require adding an extra method
+  return safe_unbox<QVariant&>(data_f(m_data, static_cast<int>(role), row+1, column+1));
+}
+
+const QVariant* JuliaItemModel::cached_data(int row, int column, int role) const
+{
+  if(m_tile_rows <= 0 || m_tile_columns <= 0)
+  {
+    return nullptr;
+  }
+
+  // A role that was not seen before is added to all tiles, so the cached tiles are outdated
+  qsizetype role_idx = m_tile_roles.indexOf(role);
+  if(role_idx == -1)
+  {
+    m_tile_roles.push_back(role);
+    m_tiles.clear();
+    role_idx = m_tile_roles.size() - 1;
+  }
+
+  const int tile_row = row / m_tile_rows;
+  const int tile_column = column / m_tile_columns;
+  DataTile* tile = m_tiles.object(tile_key(tile_row, tile_column));
+  if(tile == nullptr)
+  {
+    tile = load_tile(tile_row, tile_column);
+  }
+  if(tile == nullptr || row >= tile->first_row + tile->nb_rows || column >= tile->first_column + tile->nb_columns)
+  {
+    return nullptr;
+  }
+
+  const qsizetype cell_idx = qsizetype(row - tile->first_row)*tile->nb_columns + (column - tile->first_column);
+  return &tile->values[cell_idx*m_tile_roles.size() + role_idx];
+}
+
+JuliaItemModel::DataTile* JuliaItemModel::load_tile(int tile_row, int tile_column) const
+{
+  const int first_row = tile_row*m_tile_rows;
+  const int first_column = tile_column*m_tile_columns;
+  const int nb_rows = std::min(m_tile_rows, rowCount() - first_row);
+  const int nb_columns = std::min(m_tile_columns, columnCount() - first_column);
+  if(nb_rows <= 0 || nb_columns <= 0)
+  {
+    return nullptr;
+  }
+
+  auto tile = std::make_unique<DataTile>(DataTile{first_row, first_column, nb_rows, nb_columns, QVariantList()});
+  const qsizetype nb_values = qsizetype(nb_rows)*nb_columns*m_tile_roles.size();
+  tile->values.reserve(nb_values);
+
+  {
+    GCGuard gc_guard("JuliaItemModel::load_tile");
+    // data_block! fills the list for the whole block at once, if the QML module provides it. It does not know about
+    // the role getters, so these are called for each cell instead.
+    static jl_function_t* data_block_f = jl_get_function(m_qml_mod, "data_block!");
+    if(data_block_f != nullptr && m_role_getters.isEmpty())
+    {
+      static const jlcxx::JuliaFunction data_block(data_block_f);
+      const QList<int>& roles = m_tile_roles;
+      data_block(tile->values, m_data, roles, first_row+1, first_column+1, first_row+nb_rows, first_column+nb_columns);
+    }
+    else
+    {
+      for(int row = first_row; row != first_row + nb_rows; ++row)
+      {
+        for(int column = first_column; column != first_column + nb_columns; ++column)
+        {
+          for(const int role : m_tile_roles)
+          {
+            tile->values.push_back(fetch_data(row, column, role));
+          }
+        }
+      }
+    }
+  }
+
+  ++m_tile_cache_misses;
+  if(tile->values.size() != nb_values)
+  {
+    qWarning() << "data_block! returned" << tile->values.size() << "values, expected" << nb_values;
+    return nullptr;
+  }
+
+  DataTile* result = tile.release();
+  // On failure, the cache deletes the tile
+  if(!m_tiles.insert(tile_key(tile_row, tile_column), result, nb_values))
+  {
+    return nullptr;
+  }
+  return result;
+}
+
+void JuliaItemModel::invalidate_tiles(int startrow, int startcol, int endrow, int endcol)
+{
+  for(const quint64 key : m_tiles.keys())
+  {
+    const DataTile* tile = m_tiles.object(key);
+    const bool overlaps = tile->first_row < endrow && startrow <= tile->first_row + tile->nb_rows
+      && tile->first_column < endcol && startcol <= tile->first_column + tile->nb_columns;
+    if(overlaps)
+    {
+      m_tiles.remove(key);
+    }
+  }
+}
+
+void JuliaItemModel::set_native_column(int column, jl_value_t* array)
+{
+  if(column < 1)
+  {
+    throw std::runtime_error("Invalid column index " + std::to_string(column));
+  }
+  if(!jl_is_array(array) || jl_array_ndims(reinterpret_cast<jl_array_t*>(array)) != 1)
+  {
+    throw std::runtime_error("Native columns must be backed by a Vector");
+  }
+
+  NativeColumn native_column;
+  jl_value_t* eltype = reinterpret_cast<jl_value_t*>(jl_array_eltype(array));
+  if(eltype == reinterpret_cast<jl_value_t*>(jl_float64_type))
+  {
+    native_column.eltype = NativeColumn::Float64;
+  }
+  else if(eltype == reinterpret_cast<jl_value_t*>(jl_float32_type))
+  {
+    native_column.eltype = NativeColumn::Float32;
+  }
+  else if(eltype == reinterpret_cast<jl_value_t*>(jl_int64_type))
+  {
+    native_column.eltype = NativeColumn::Int64;
+  }
+  else if(eltype == reinterpret_cast<jl_value_t*>(jl_int32_type))
+  {
+    native_column.eltype = NativeColumn::Int32;
+  }
+  else if(eltype == reinterpret_cast<jl_value_t*>(jl_bool_type))
+  {
+    native_column.eltype = NativeColumn::Bool;
+  }
+  else
+  {
+    throw std::runtime_error("Unsupported element type for a native column");
+  }
+
+  native_column.array = GCRoot(array, GCRootArena::Subsystem::ItemModel);
+
+  const std::size_t column_idx = column - 1;
+  if(column_idx >= m_native_columns.size())
+  {
+    m_native_columns.resize(column_idx + 1);
+  }
+  m_native_columns[column_idx] = std::move(native_column);
+  refresh_native_columns();
+  invalidate_tiles(1, column, std::numeric_limits<int>::max(), column);
+}
+
+void JuliaItemModel::clear_native_columns()
+{
+  m_native_columns.clear();
+}
+
+bool JuliaItemModel::native_column_values(int column, std::vector<double>& values) const
+{
+  if(column < 0 || column >= int(m_native_columns.size()) || m_native_columns[column].array.empty())
+  {
+    return false;
+  }
+  const NativeColumn& native_column = m_native_columns[column];
+  values.resize(native_column.length);
+  auto copy_values = [&values, &native_column] (auto* typed_data)
+  {
+    std::copy(typed_data, typed_data + native_column.length, values.begin());
+  };
+  switch(native_column.eltype)
+  {
+  case NativeColumn::Float64:
+    copy_values(static_cast<const double*>(native_column.data));
+    break;
+  case NativeColumn::Float32:
+    copy_values(static_cast<const float*>(native_column.data));
+    break;
+  case NativeColumn::Int64:
+    copy_values(static_cast<const int64_t*>(native_column.data));
+    break;
+  case NativeColumn::Int32:
+    copy_values(static_cast<const int32_t*>(native_column.data));
+    break;
+  case NativeColumn::Bool:
+    copy_values(static_cast<const uint8_t*>(native_column.data));
+    break;
+  }
+  return true;
+}
+
+QVariant JuliaItemModel::NativeColumn::value(int row) const
+{
+  switch(eltype)
+  {
+  case Float64:
+    return QVariant(static_cast<const double*>(data)[row]);
+  case Float32:
+    return QVariant(static_cast<const float*>(data)[row]);
+  case Int64:
+    return QVariant(qlonglong(static_cast<const int64_t*>(data)[row]));
+  case Int32:
+    return QVariant(int(static_cast<const int32_t*>(data)[row]));
+  case Bool:
+    return QVariant(static_cast<const uint8_t*>(data)[row] != 0);
+  }
+  return QVariant();
+}
+
+void JuliaItemModel::set_fetch_policy(int chunk_size, int prefetch_distance)
+{
+  m_fetch_chunk_size = chunk_size;
+  m_prefetch_distance = prefetch_distance;
+}
+
+void JuliaItemModel::prefetch(int row) const
+{
+  if(m_fetch_chunk_size <= 0 || m_fetch_queued || row < rowCount() - m_prefetch_distance)
+  {
+    return;
+  }
+  // Fetching inserts rows, which must not happen while a view is reading the data
+  m_fetch_queued = true;
+  JuliaItemModel* self = const_cast<JuliaItemModel*>(this);
+  QMetaObject::invokeMethod(self, [self]()
+  {
+    if(self->canFetchMore(QModelIndex()))
+    {
+      self->fetchMore(QModelIndex());
+    }
+    self->m_fetch_queued = false;
+  }, Qt::QueuedConnection);
+}
+
+void JuliaItemModel::set_batch_updates(bool enabled)
+{
+  m_batch_updates = enabled;
+  if(!enabled)
+  {
+    flush_data_changes();
+  }
+}
+
+void JuliaItemModel::set_flush_window(QQuickWindow* window)
+{
+  QObject::disconnect(m_flush_connection);
+  m_flush_window = window;
+  if(window != nullptr)
+  {
+    if(m_frame_flush_timer == nullptr)
+    {
+      m_frame_flush_timer = new QTimer(this);
+      m_frame_flush_timer->setSingleShot(true);
+      m_frame_flush_timer->setInterval(frame_flush_timeout_ms);
+      connect(m_frame_flush_timer, &QTimer::timeout, this, &JuliaItemModel::flush_frame);
+    }
+    // afterAnimating is emitted on the GUI thread, once per frame and before the scene graph is synchronized
+    m_flush_connection = connect(window, &QQuickWindow::afterAnimating, this, &JuliaItemModel::flush_frame);
+  }
+  else if(m_frame_flush_timer != nullptr && m_frame_flush_timer->isActive())
+  {
+    m_frame_flush_timer->stop();
+    flush_frame();
+  }
+}
+
+void JuliaItemModel::flush_frame()
+{
+  if(m_frame_flush_timer != nullptr)
+  {
+    m_frame_flush_timer->stop();
+  }
+  drain_row_queue();
+  flush_data_changes();
+}
+
+// The window may not render, when it is minimized or nothing is animating, so the timer flushes in that case
+void JuliaItemModel::request_frame()
+{
+  m_flush_window->update();
+  if(!m_frame_flush_timer->isActive())
+  {
+    m_frame_flush_timer->start();
+  }
+}
+
+void JuliaItemModel::flush_data_changes()
+{
+  m_flush_queued = false;
+  std::vector<QRect> changes;
+  changes.swap(m_pending_changes);
+  for(const QRect& changed : changes)
+  {
+    emit dataChanged(createIndex(changed.top(), changed.left()), createIndex(changed.bottom(), changed.right()));
+  }
+}
+
+void JuliaItemModel::queue_data_changed(QRect changed)
+{
+  // Merge with all overlapping or adjacent ranges, repeating until no pending range touches the result
+  bool merged = true;
+  while(merged)
+  {
+    merged = false;
+    for(auto it = m_pending_changes.begin(); it != m_pending_changes.end(); ++it)
+    {
+      if(it->adjusted(-1, -1, 1, 1).intersects(changed))
+      {
+        changed = changed.united(*it);
+        m_pending_changes.erase(it);
+        merged = true;
+        break;
+      }
+    }
+  }
+  m_pending_changes.push_back(changed);
+
+  if(m_pending_changes.size() > max_pending_changes)
+  {
+    QRect bounds;
+    for(const QRect& pending : m_pending_changes)
+    {
+      bounds = bounds.united(pending);
+    }
+    m_pending_changes.assign(1, bounds);
+  }
+
+  if(m_flush_window != nullptr)
+  {
+    request_frame();
+    return;
+  }
+  if(!m_flush_queued)
+  {
+    m_flush_queued = true;
+    QMetaObject::invokeMethod(this, &JuliaItemModel::flush_data_changes, Qt::QueuedConnection);
+  }
+}
+
+bool JuliaItemModel::update_rows(jl_value_t* new_data, jlcxx::ArrayRef<uint64_t> old_keys, jlcxx::ArrayRef<uint64_t> new_keys, int max_edits)
+{
+  return update_rows(new_data, old_keys.data(), old_keys.size(), new_keys.data(), new_keys.size(), nullptr, nullptr, max_edits);
+}
+
+bool JuliaItemModel::update_rows(jl_value_t* new_data, jlcxx::ArrayRef<uint64_t> old_keys, jlcxx::ArrayRef<uint64_t> new_keys,
+  jlcxx::ArrayRef<uint64_t> old_hashes, jlcxx::ArrayRef<uint64_t> new_hashes, int max_edits)
+{
+  if(old_hashes.size() != old_keys.size() || new_hashes.size() != new_keys.size())
+  {
+    throw std::runtime_error("update_rows needs one hash per key");
+  }
+  return update_rows(new_data, old_keys.data(), old_keys.size(), new_keys.data(), new_keys.size(), old_hashes.data(), new_hashes.data(), max_edits);
+}
+
+bool JuliaItemModel::update_rows(jl_value_t* new_data, const uint64_t* old_keys, std::size_t nb_old, const uint64_t* new_keys, std::size_t nb_new,
+  const uint64_t* old_hashes, const uint64_t* new_hashes, int max_edits)
+{
+  static const jlcxx::JuliaFunction apply_row_edit(jl_get_function(m_qml_mod, "apply_row_edit!"));
+  auto apply = [&] (const RowEdit::Kind kind, const int first, const int count, const int source)
+  {
+    apply_row_edit(m_data, new_data, static_cast<int>(kind), first+1, count, source+1);
+  };
+
+  std::vector<RowEdit> edits;
+  if(!compute_row_edits(old_keys, nb_old, new_keys, nb_new, max_edits, edits, old_hashes, new_hashes))
+  {
+    static const jlcxx::JuliaFunction replace_rows(jl_get_function(m_qml_mod, "replace_rows!"));
+    begin_reset_model();
+    replace_rows(m_data, new_data);
+    end_reset_model();
+    return false;
+  }
+
+  for(const RowEdit& edit : edits)
+  {
+    switch(edit.kind)
+    {
+    case RowEdit::Remove:
+      begin_remove_rows(edit.first+1, edit.count);
+      apply(edit.kind, edit.first, edit.count, edit.source);
+      end_remove_rows();
+      break;
+    case RowEdit::Move:
+    {
+      // compute_row_edits leaves out moves to the same position, the only ones beginMoveRows refuses here
+      const bool moved = begin_move_rows(edit.source+1, edit.first+1, 1);
+      assert(moved);
+      (void)moved;
+      apply(edit.kind, edit.first, edit.count, edit.source);
+      end_move_rows();
+      break;
+    }
+    case RowEdit::Insert:
+      begin_insert_rows(edit.first+1, edit.first+edit.count);
+      apply(edit.kind, edit.first, edit.count, edit.source);
+      end_insert_rows();
+      break;
+    case RowEdit::Replace:
+      apply(edit.kind, edit.first, edit.count, edit.source);
+      emit_data_changed(edit.first+1, 1, edit.first+edit.count, columnCount());
+      break;
+    }
+  }
+  return true;
+}
+
+void JuliaItemModel::push_rows(jl_value_t* rows, int nb_rows)
+{
+  m_row_queue.push(RowBatch{GCRoot(rows, GCRootArena::Subsystem::ItemModel), nb_rows});
+  // The flag is cleared when a drain starts, so batches pushed during a drain schedule the next one
+  if(!m_drain_queued.exchange(true))
+  {
+    QMetaObject::invokeMethod(this, &JuliaItemModel::request_drain, Qt::QueuedConnection);
+  }
+}
+
+void JuliaItemModel::set_max_rows_per_drain(int max_rows)
+{
+  m_max_rows_per_drain = max_rows;
+}
+
+void JuliaItemModel::request_drain()
+{
+  if(m_flush_window != nullptr)
+  {
+    request_frame();
+    return;
+  }
+  drain_row_queue();
+}
+
+void JuliaItemModel::drain_row_queue()
+{
+  m_drain_queued = false;
+  std::vector<RowBatch> batches;
+  int nb_rows = 0;
+  RowBatch batch;
+  while((m_max_rows_per_drain <= 0 || nb_rows < m_max_rows_per_drain) && m_row_queue.pop(batch))
+  {
+    nb_rows += batch.nb_rows;
+    batches.push_back(std::move(batch));
+  }
+  if(batches.empty())
+  {
+    return;
+  }
+
+  {
+    GCGuard gc_guard(JuliaPriority::Normal, "JuliaItemModel::drain_row_queue");
+    static const jlcxx::JuliaFunction append_rows(jl_get_function(m_qml_mod, "append_rows!"));
+    const int first = rowCount() + 1;
+    if(nb_rows > 0)
+    {
+      begin_insert_rows(first, first + nb_rows - 1);
+    }
+    ForeignThreadManager& manager = ForeignThreadManager::instance();
+    for(const RowBatch& queued : batches)
+    {
+      append_rows(m_data, queued.rows.value());
+      // Rendering and calls from QML don't wait for the whole drain
+      manager.yield_to_higher_priority();
+    }
+    if(nb_rows > 0)
+    {
+      end_insert_rows();
+    }
+  }
+
+  // The limit was reached, the remaining batches are appended in the next drain
+  if(m_max_rows_per_drain > 0 && nb_rows >= m_max_rows_per_drain && !m_drain_queued.exchange(true))
+  {
+    QMetaObject::invokeMethod(this, &JuliaItemModel::request_drain, Qt::QueuedConnection);
+  }
+}
+
+void JuliaItemModel::refresh_native_columns()
+{
+  for(NativeColumn& column : m_native_columns)
+  {
+    if(!column.array.empty())
+    {
+      jl_array_t* arr = reinterpret_cast<jl_array_t*>(column.array.value());
+      column.data = julia_array_data(arr);
+      column.length = int(jl_array_len(arr));
+    }
+  }
+}
+
+void JuliaItemModel::invalidate_caches()
+{
+  m_row_count = -1;
+  m_column_count = -1;
+  m_tiles.clear();
+  refresh_native_columns();
+}
+
+void JuliaItemModel::invalidate_rows_from(int row)
+{
+  m_row_count = -1;
+  refresh_native_columns();
+  // Tiles before the changed row stay valid. The tile ending right before it may be incomplete, so it is dropped too.
+  invalidate_tiles(std::max(row - 1, 1), 1, std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+}
+
 } // namespace qmlwrap
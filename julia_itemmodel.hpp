@@ -1,13 +1,26 @@
 #ifndef QML_JULIAITEMMODEL_H
 #define QML_JULIAITEMMODEL_H
 
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <QAbstractTableModel>
+#include <QCache>
+#include <QPointer>
+#include <QQuickWindow>
+#include <QRect>
+#include <QTimer>
 
+#include "jlcxx/jlcxx.hpp"
+#include "jlcxx/array.hpp"
 #include "jlcxx/functions.hpp"
 
+#include "gc_root_arena.hpp"
+#include "mpsc_queue.hpp"
+
 namespace qmlwrap
 {
 
@@ -17,6 +30,7 @@ class JuliaItemModel : public QAbstractTableModel
   Q_OBJECT
 public:
   static jl_module_t* m_qml_mod;
+  typedef jl_value_t* (*role_getter_t)(jl_value_t*, int, int);
 
   JuliaItemModel(jl_value_t* data, QObject* parent = nullptr);
   ~JuliaItemModel();
@@ -29,6 +43,8 @@ public:
   bool setHeaderData(int section, Qt::Orientation orientation, const QVariant& value, int role = Qt::EditRole) override;
   Qt::ItemFlags flags(const QModelIndex& index) const override;
   QHash<int,QByteArray> roleNames() const override;
+  bool canFetchMore(const QModelIndex& parent) const override;
+  void fetchMore(const QModelIndex& parent) override;
 
   // Same interface as in Qt6 labs QQmlTableModel
   Q_INVOKABLE void clear();
@@ -64,8 +80,145 @@ public:
   QHash<int,QByteArray> default_role_names() const;
   jl_value_t* get_julia_data() const;
 
+  // Use a C function getter(data, row, column) returning a QVariant to get the data for role, instead of the generic
+  // data function. Rows and columns are 1-based.
+  void set_role_getter(int role, jlcxx::SafeCFunction getter);
+  void clear_role_getters();
+
+  // Number of rowCount/columnCount calls that were answered without calling Julia
+  uint64_t count_cache_hits() const;
+
+  // Size of the blocks of cells that data() fetches from Julia in one go. Zero disables the cache.
+  void set_tile_size(int rows, int columns);
+  // Number of tiles that had to be fetched from Julia
+  uint64_t tile_cache_misses() const;
+
+  // Serve the display and edit roles of a column directly from the memory of a Julia vector
+  // of Float64, Float32, Int64, Int32 or Bool, without entering Julia
+  void set_native_column(int column, jl_value_t* array);
+  void clear_native_columns();
+  // Copy the values of a native column (0-based), returns false if the column is stored in Julia
+  bool native_column_values(int column, std::vector<double>& values) const;
+
+  // Load rows incrementally using the can_fetch_more and fetch_more! Julia functions, chunk_size rows at a time.
+  // A fetch is also started when data() reaches the last prefetch_distance rows. A chunk size of 0 disables this.
+  void set_fetch_policy(int chunk_size, int prefetch_distance);
+
+  // When enabled, emit_data_changed only records the changed cells and dataChanged is emitted for the merged
+  // ranges once per event loop iteration, or once per frame of the window passed to set_flush_window. If the window
+  // does not render a frame within 100 ms, the changes are flushed anyway.
+  void set_batch_updates(bool enabled);
+  void set_flush_window(QQuickWindow* window);
+  void flush_data_changes();
+
+  // Replace the rows by new_data, emitting the row removals, moves and insertions found by comparing the keys of the
+  // old and new rows instead of resetting the model. The Julia data is updated step by step by calling
+  // apply_row_edit!(data, new_data, kind, first, count, source), with 1-based positions, after each begin hook:
+  // - Remove (0): delete rows first:first+count-1
+  // - Move (1): take out row source and put it back at position first, count is always 1
+  // - Insert (2): insert rows source:source+count-1 of new_data at position first
+  // - Replace (3): overwrite rows first:first+count-1 with the same rows of new_data, without changing the row count
+  // dataChanged is emitted for each replaced range. If more than max_edits rows would be inserted or removed, the
+  // model is reset around replace_rows!(data, new_data), which must replace all rows at once, and false is returned.
+  bool update_rows(jl_value_t* new_data, jlcxx::ArrayRef<uint64_t> old_keys, jlcxx::ArrayRef<uint64_t> new_keys, int max_edits);
+  // Same, with a hash of the contents of each row, so only the kept rows with a different hash are replaced
+  bool update_rows(jl_value_t* new_data, jlcxx::ArrayRef<uint64_t> old_keys, jlcxx::ArrayRef<uint64_t> new_keys,
+    jlcxx::ArrayRef<uint64_t> old_hashes, jlcxx::ArrayRef<uint64_t> new_hashes, int max_edits);
+
+  // Queue a batch of nb_rows rows to be appended, callable from any thread. The batches are appended on the GUI thread
+  // using the append_rows! Julia function, with a single row insertion per drain of the queue. The queue is drained
+  // once per event loop iteration, or once per frame of the window passed to set_flush_window.
+  void push_rows(jl_value_t* rows, int nb_rows);
+  // Soft limit on the number of rows appended per drain, remaining batches wait for the next one. Batches are not split,
+  // so a drain can go over the limit by the size of its last batch. Zero means no limit.
+  void set_max_rows_per_drain(int max_rows);
+  void drain_row_queue();
+
 private:
+  // Column backed by the memory of a Julia vector. The pointer and length are read again after
+  // each change notification, since resizing the vector may move its data.
+  struct NativeColumn
+  {
+    enum ElementType { Float64, Float32, Int64, Int32, Bool };
+
+    QVariant value(int row) const;
+
+    GCRoot array;
+    ElementType eltype = Float64;
+    const void* data = nullptr;
+    int length = 0;
+  };
+
+  void refresh_native_columns();
+  void prefetch(int row) const;
+  void queue_data_changed(QRect changed);
+
+  // Block of cells, holding the values for all roles in m_tile_roles
+  struct DataTile
+  {
+    int first_row;
+    int first_column;
+    int nb_rows;
+    int nb_columns;
+    QVariantList values; // row-major, with the roles of each cell stored contiguously
+  };
+
+  // Get the value for a cell directly from Julia, the caller must hold a GCGuard
+  QVariant fetch_data(int row, int column, int role) const;
+  const QVariant* cached_data(int row, int column, int role) const;
+  DataTile* load_tile(int tile_row, int tile_column) const;
+  void invalidate_tiles(int startrow, int startcol, int endrow, int endcol);
+  void invalidate_caches();
+  void invalidate_rows_from(int row);
+  void request_drain();
+  void request_frame();
+  void flush_frame();
+  bool update_rows(jl_value_t* new_data, const uint64_t* old_keys, std::size_t nb_old, const uint64_t* new_keys, std::size_t nb_new,
+    const uint64_t* old_hashes, const uint64_t* new_hashes, int max_edits);
+
+  // Batch of rows queued by push_rows, rows is protected from garbage collection until it is appended
+  struct RowBatch
+  {
+    GCRoot rows;
+    int nb_rows = 0;
+  };
+
   jl_value_t* m_data;
+  GCRoot m_data_root;
+  QHash<int, role_getter_t> m_role_getters;
+  // Role names are asked to Julia only once, and again after a reset
+  mutable QHash<int,QByteArray> m_role_names;
+  mutable bool m_role_names_valid = false;
+  std::vector<NativeColumn> m_native_columns; // indexed by column, array is empty for columns stored in Julia
+
+  // Row and column counts are cached until the next structural change, -1 means not known
+  mutable int m_row_count = -1;
+  mutable int m_column_count = -1;
+  mutable uint64_t m_count_cache_hits = 0;
+
+  int m_tile_rows = 64;
+  int m_tile_columns = 16;
+  mutable QList<int> m_tile_roles; // roles requested by the views so far
+  mutable QCache<quint64, DataTile> m_tiles;
+  mutable uint64_t m_tile_cache_misses = 0;
+
+  int m_fetch_chunk_size = 0;
+  int m_prefetch_distance = 0;
+  mutable bool m_fetch_queued = false;
+
+  bool m_batch_updates = false;
+  bool m_flush_queued = false;
+  std::vector<QRect> m_pending_changes; // x is the column, y the row
+  QPointer<QQuickWindow> m_flush_window;
+  QMetaObject::Connection m_flush_connection;
+  QTimer* m_frame_flush_timer = nullptr;
+
+  // First row (1-based) affected by the row insertion or removal in progress
+  int m_changed_first_row = 1;
+
+  MpscQueue<RowBatch> m_row_queue;
+  std::atomic<bool> m_drain_queued = false;
+  int m_max_rows_per_drain = 0;
 };
 
 }
@@ -15,7 +15,7 @@ JuliaPaintedItem::JuliaPaintedItem(QQuickItem *parent) : QQuickPaintedItem(paren
 
 void JuliaPaintedItem::paint(QPainter* painter)
 {
-  GCGuard gc_guard;
+  GCGuard gc_guard("JuliaPaintedItem::paint");
   m_callback(painter, this);
 }
 
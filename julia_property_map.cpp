@@ -9,13 +9,11 @@ JuliaPropertyMap::JuliaPropertyMap(QObject *parent) : QQmlPropertyMap(this,paren
 
 JuliaPropertyMap::~JuliaPropertyMap()
 {
-  jlcxx::unprotect_from_gc(m_julia_value);
 }
 
 void JuliaPropertyMap::set_julia_value(jl_value_t* val)
 {
-  jlcxx::protect_from_gc(val);
-  m_julia_value = val;
+  m_julia_value = GCRoot(val, GCRootArena::Subsystem::PropertyMap);
 }
 
 } // namespace qmlwrap
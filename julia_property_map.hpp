@@ -5,6 +5,8 @@
 
 #include <QQmlPropertyMap>
 
+#include "gc_root_arena.hpp"
+
 namespace qmlwrap
 {
 
@@ -15,13 +17,13 @@ class JuliaPropertyMap : public QQmlPropertyMap
 public:
   JuliaPropertyMap(QObject* parent = nullptr);
   virtual ~JuliaPropertyMap();
-  jl_value_t* julia_value() { return m_julia_value; }
+  jl_value_t* julia_value() { return m_julia_value.value(); }
   void set_julia_value(jl_value_t* val);
 
 private:
   
   // This corresponds to the Julia object, which itself holds this JuliaPropertyMap together with a Dict
-  jl_value_t* m_julia_value = nullptr;
+  GCRoot m_julia_value;
 
 };
 
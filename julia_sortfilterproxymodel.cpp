@@ -0,0 +1,688 @@
+#include "julia_sortfilterproxymodel.hpp"
+#include "foreign_thread_manager.hpp"
+#include "jlqml.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include <QDebug>
+#include <QSemaphore>
+#include <QThreadPool>
+
+namespace qmlwrap
+{
+
+namespace
+{
+  // Below this number of rows, sorting is done on the calling thread only
+  constexpr std::size_t parallel_sort_threshold = 1 << 16;
+  constexpr unsigned max_sort_threads = 8;
+  // Source insertions and removals that are scattered over more proxy ranges than this reset the model instead
+  constexpr std::size_t max_mapped_ranges = 64;
+
+  struct SortItem
+  {
+    double key;
+    int row;
+  };
+
+  // Threads shared by all sorts. The pool of ForeignThreadManager is not used, since its threads may be waiting for the
+  // Julia lock held by the sorting thread.
+  QThreadPool& sort_thread_pool()
+  {
+    static QThreadPool* pool = []()
+    {
+      QThreadPool* result = new QThreadPool();
+      result->setMaxThreadCount(int(max_sort_threads) - 1);
+      return result;
+    }();
+    return *pool;
+  }
+
+  // Run the tasks in parallel, using the calling thread for the first one
+  void run_parallel(const std::vector<std::function<void()>>& tasks)
+  {
+    QSemaphore done;
+    for(std::size_t i = 1; i < tasks.size(); ++i)
+    {
+      sort_thread_pool().start([&task = tasks[i], &done] ()
+      {
+        task();
+        done.release();
+      });
+    }
+    if(!tasks.empty())
+    {
+      tasks.front()();
+      done.acquire(int(tasks.size()) - 1);
+    }
+  }
+
+  // Sort rows on the key of each row. NaN keys are put last and equal keys keep the source order.
+  // Large inputs are split in chunks that are sorted in parallel and then merged pairwise, also in parallel.
+  void sort_rows(std::vector<int>& rows, const std::vector<double>& keys, const bool descending)
+  {
+    const std::size_t nb_items = rows.size();
+    std::vector<SortItem> items(nb_items);
+    for(std::size_t i = 0; i != nb_items; ++i)
+    {
+      items[i] = SortItem{keys[rows[i]], rows[i]};
+    }
+
+    auto less = [descending] (const SortItem& a, const SortItem& b)
+    {
+      const bool a_nan = std::isnan(a.key);
+      const bool b_nan = std::isnan(b.key);
+      if(a_nan || b_nan)
+      {
+        return a_nan == b_nan ? a.row < b.row : b_nan;
+      }
+      if(a.key != b.key)
+      {
+        return descending ? a.key > b.key : a.key < b.key;
+      }
+      return a.row < b.row;
+    };
+
+    std::size_t nb_chunks = 1;
+    if(nb_items >= parallel_sort_threshold)
+    {
+      nb_chunks = std::clamp(std::thread::hardware_concurrency(), 1u, max_sort_threads);
+    }
+    std::vector<std::size_t> bounds(nb_chunks + 1);
+    for(std::size_t i = 0; i <= nb_chunks; ++i)
+    {
+      bounds[i] = nb_items * i / nb_chunks;
+    }
+
+    std::vector<std::function<void()>> tasks;
+    for(std::size_t i = 0; i != nb_chunks; ++i)
+    {
+      tasks.push_back([&items, &less, first = bounds[i], last = bounds[i+1]] ()
+      {
+        std::sort(items.begin() + first, items.begin() + last, less);
+      });
+    }
+    run_parallel(tasks);
+
+    while(bounds.size() > 2)
+    {
+      tasks.clear();
+      std::vector<std::size_t> merged_bounds;
+      const std::size_t nb_sorted = bounds.size() - 1;
+      for(std::size_t i = 0; i < nb_sorted; i += 2)
+      {
+        merged_bounds.push_back(bounds[i]);
+        if(i + 1 == nb_sorted)
+        {
+          break;
+        }
+        tasks.push_back([&items, &less, first = bounds[i], middle = bounds[i+1], last = bounds[i+2]] ()
+        {
+          std::inplace_merge(items.begin() + first, items.begin() + middle, items.begin() + last, less);
+        });
+      }
+      merged_bounds.push_back(nb_items);
+      run_parallel(tasks);
+      bounds.swap(merged_bounds);
+    }
+
+    for(std::size_t i = 0; i != nb_items; ++i)
+    {
+      rows[i] = items[i].row;
+    }
+  }
+}
+
+JuliaSortFilterProxyModel::JuliaSortFilterProxyModel(JuliaItemModel* source, QObject* parent) : QAbstractProxyModel(parent)
+{
+  setSourceModel(source);
+}
+
+JuliaSortFilterProxyModel::~JuliaSortFilterProxyModel() = default;
+
+void JuliaSortFilterProxyModel::setSourceModel(QAbstractItemModel* source)
+{
+  JuliaItemModel* julia_source = qobject_cast<JuliaItemModel*>(source);
+  if(source != nullptr && julia_source == nullptr)
+  {
+    qWarning() << "The source of a JuliaSortFilterProxyModel must be a JuliaItemModel";
+    return;
+  }
+
+  beginResetModel();
+  if(m_source != nullptr)
+  {
+    disconnect(m_source, nullptr, this, nullptr);
+  }
+  QAbstractProxyModel::setSourceModel(source);
+  m_source = julia_source;
+  if(m_source != nullptr)
+  {
+    // Row insertions and removals are mapped to the proxy rows, other structural changes rebuild the permutation
+    auto begin_reset = [this] () { beginResetModel(); };
+    auto end_reset = [this] () { source_reset(); };
+    connect(m_source, &QAbstractItemModel::modelAboutToBeReset, this, begin_reset);
+    connect(m_source, &QAbstractItemModel::modelReset, this, end_reset);
+    connect(m_source, &QAbstractItemModel::rowsInserted, this, &JuliaSortFilterProxyModel::source_rows_inserted);
+    connect(m_source, &QAbstractItemModel::rowsAboutToBeRemoved, this, &JuliaSortFilterProxyModel::source_rows_about_to_be_removed);
+    connect(m_source, &QAbstractItemModel::rowsRemoved, this, &JuliaSortFilterProxyModel::source_rows_removed);
+    connect(m_source, &QAbstractItemModel::rowsAboutToBeMoved, this, begin_reset);
+    connect(m_source, &QAbstractItemModel::rowsMoved, this, end_reset);
+    connect(m_source, &QAbstractItemModel::columnsAboutToBeInserted, this, begin_reset);
+    connect(m_source, &QAbstractItemModel::columnsInserted, this, end_reset);
+    connect(m_source, &QAbstractItemModel::columnsAboutToBeRemoved, this, begin_reset);
+    connect(m_source, &QAbstractItemModel::columnsRemoved, this, end_reset);
+    connect(m_source, &QAbstractItemModel::columnsAboutToBeMoved, this, begin_reset);
+    connect(m_source, &QAbstractItemModel::columnsMoved, this, end_reset);
+    connect(m_source, &QAbstractItemModel::layoutAboutToBeChanged, this, begin_reset);
+    connect(m_source, &QAbstractItemModel::layoutChanged, this, end_reset);
+    connect(m_source, &QAbstractItemModel::dataChanged, this, &JuliaSortFilterProxyModel::source_data_changed);
+    connect(m_source, &QAbstractItemModel::headerDataChanged, this, &QAbstractItemModel::headerDataChanged);
+  }
+  source_reset();
+}
+
+QModelIndex JuliaSortFilterProxyModel::mapToSource(const QModelIndex& proxy_index) const
+{
+  if(m_source == nullptr || !proxy_index.isValid() || proxy_index.row() >= int(m_proxy_to_source.size()))
+  {
+    return QModelIndex();
+  }
+  return m_source->index(m_proxy_to_source[proxy_index.row()], proxy_index.column());
+}
+
+QModelIndex JuliaSortFilterProxyModel::mapFromSource(const QModelIndex& source_index) const
+{
+  if(!source_index.isValid() || source_index.row() >= int(m_source_to_proxy.size()))
+  {
+    return QModelIndex();
+  }
+  const int row = m_source_to_proxy[source_index.row()];
+  if(row < 0)
+  {
+    return QModelIndex();
+  }
+  return createIndex(row, source_index.column());
+}
+
+QModelIndex JuliaSortFilterProxyModel::index(int row, int column, const QModelIndex& parent) const
+{
+  if(parent.isValid() || row < 0 || row >= rowCount() || column < 0 || column >= columnCount())
+  {
+    return QModelIndex();
+  }
+  return createIndex(row, column);
+}
+
+QModelIndex JuliaSortFilterProxyModel::parent(const QModelIndex&) const
+{
+  return QModelIndex();
+}
+
+int JuliaSortFilterProxyModel::rowCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : int(m_proxy_to_source.size());
+}
+
+int JuliaSortFilterProxyModel::columnCount(const QModelIndex& parent) const
+{
+  return (parent.isValid() || m_source == nullptr) ? 0 : m_source->columnCount();
+}
+
+bool JuliaSortFilterProxyModel::hasChildren(const QModelIndex& parent) const
+{
+  return !parent.isValid() && !m_proxy_to_source.empty();
+}
+
+void JuliaSortFilterProxyModel::sort(int column, Qt::SortOrder order)
+{
+  m_sort_column = column;
+  m_sort_order = order;
+  resort();
+}
+
+void JuliaSortFilterProxyModel::set_filter(jl_value_t* filter)
+{
+  m_filter = GCRoot(filter, GCRootArena::Subsystem::ItemModel);
+  invalidate();
+}
+
+void JuliaSortFilterProxyModel::clear_filter()
+{
+  if(m_filter.empty())
+  {
+    return;
+  }
+  m_filter = GCRoot();
+  invalidate();
+}
+
+void JuliaSortFilterProxyModel::invalidate()
+{
+  std::vector<int> rows;
+  compute_rows(rows);
+  reset_rows(std::move(rows));
+}
+
+int JuliaSortFilterProxyModel::sort_column() const
+{
+  return m_sort_column;
+}
+
+void JuliaSortFilterProxyModel::compute_rows(std::vector<int>& rows) const
+{
+  rows.clear();
+  if(m_source == nullptr)
+  {
+    return;
+  }
+  const int nb_rows = m_source->rowCount();
+
+  bool filtered = false;
+  if(!m_filter.empty())
+  {
+    GCGuard gc_guard;
+    jl_value_t* mask = jlcxx::JuliaFunction(m_filter.value())(m_source->get_julia_data());
+    if(mask != nullptr && jl_is_array(mask) && jl_array_eltype(mask) == reinterpret_cast<jl_value_t*>(jl_bool_type)
+      && int(jl_array_len(reinterpret_cast<jl_array_t*>(mask))) == nb_rows)
+    {
+      const uint8_t* keep = static_cast<const uint8_t*>(julia_array_data(reinterpret_cast<jl_array_t*>(mask)));
+      for(int row = 0; row != nb_rows; ++row)
+      {
+        if(keep[row])
+        {
+          rows.push_back(row);
+        }
+      }
+      filtered = true;
+    }
+    else
+    {
+      qWarning() << "The filter must return a Vector{Bool} with one element per row, ignoring it";
+    }
+  }
+  if(!filtered)
+  {
+    rows.resize(nb_rows);
+    for(int row = 0; row != nb_rows; ++row)
+    {
+      rows[row] = row;
+    }
+  }
+
+  sort_by_column(rows);
+}
+
+void JuliaSortFilterProxyModel::sort_by_column(std::vector<int>& rows) const
+{
+  if(m_sort_column < 0 || rows.empty())
+  {
+    return;
+  }
+  std::vector<double> keys;
+  if(sort_keys(m_sort_column, keys) && int(keys.size()) == m_source->rowCount())
+  {
+    sort_rows(rows, keys, m_sort_order == Qt::DescendingOrder);
+  }
+  else
+  {
+    qWarning() << "No sort keys with one element per row for column" << m_sort_column;
+  }
+}
+
+bool JuliaSortFilterProxyModel::filter_mask(int first, int last, std::vector<uint8_t>& keep) const
+{
+  GCGuard gc_guard;
+  static const jlcxx::JuliaFunction filter_rows(jl_get_function(JuliaItemModel::m_qml_mod, "filter_rows"));
+  jl_value_t* mask = filter_rows(m_filter.value(), m_source->get_julia_data(), first+1, last+1);
+  if(mask == nullptr || !jl_is_array(mask) || jl_array_eltype(mask) != reinterpret_cast<jl_value_t*>(jl_bool_type)
+    || int(jl_array_len(reinterpret_cast<jl_array_t*>(mask))) != last - first + 1)
+  {
+    qWarning() << "filter_rows must return a Vector{Bool} with one element per changed row";
+    return false;
+  }
+  const uint8_t* values = static_cast<const uint8_t*>(julia_array_data(reinterpret_cast<jl_array_t*>(mask)));
+  keep.assign(values, values + (last - first + 1));
+  return true;
+}
+
+void JuliaSortFilterProxyModel::set_rows(std::vector<int>&& rows)
+{
+  m_proxy_to_source = std::move(rows);
+  update_source_to_proxy();
+}
+
+void JuliaSortFilterProxyModel::update_source_to_proxy()
+{
+  m_source_to_proxy.assign(m_source == nullptr ? 0 : m_source->rowCount(), -1);
+  for(std::size_t i = 0; i != m_proxy_to_source.size(); ++i)
+  {
+    m_source_to_proxy[m_proxy_to_source[i]] = int(i);
+  }
+}
+
+void JuliaSortFilterProxyModel::reset_rows(std::vector<int>&& rows)
+{
+  beginResetModel();
+  set_rows(std::move(rows));
+  endResetModel();
+}
+
+// Reorder the rows. If the filter now shows other rows, the model is reset.
+void JuliaSortFilterProxyModel::resort()
+{
+  std::vector<int> rows;
+  compute_rows(rows);
+  if(rows.size() != m_proxy_to_source.size())
+  {
+    reset_rows(std::move(rows));
+    return;
+  }
+  reorder_rows(std::move(rows));
+}
+
+// Show the same rows in another order, keeping the persistent indexes valid
+void JuliaSortFilterProxyModel::reorder_rows(std::vector<int>&& rows)
+{
+  emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+  const QModelIndexList proxy_indexes = persistentIndexList();
+  QModelIndexList source_indexes;
+  source_indexes.reserve(proxy_indexes.size());
+  for(const QModelIndex& proxy_index : proxy_indexes)
+  {
+    source_indexes.push_back(mapToSource(proxy_index));
+  }
+
+  set_rows(std::move(rows));
+
+  QModelIndexList new_indexes;
+  new_indexes.reserve(source_indexes.size());
+  for(const QModelIndex& source_index : source_indexes)
+  {
+    new_indexes.push_back(mapFromSource(source_index));
+  }
+  changePersistentIndexList(proxy_indexes, new_indexes);
+  emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
+
+bool JuliaSortFilterProxyModel::sort_keys(int column, std::vector<double>& keys) const
+{
+  if(m_source->native_column_values(column, keys))
+  {
+    return true;
+  }
+
+  GCGuard gc_guard;
+  static const jlcxx::JuliaFunction sort_keys_f(jl_get_function(JuliaItemModel::m_qml_mod, "sort_keys"));
+  jl_value_t* result = sort_keys_f(m_source->get_julia_data(), column+1);
+  if(result == nullptr || !jl_is_array(result) || jl_array_eltype(result) != reinterpret_cast<jl_value_t*>(jl_float64_type))
+  {
+    return false;
+  }
+  jl_array_t* arr = reinterpret_cast<jl_array_t*>(result);
+  const double* values = static_cast<const double*>(julia_array_data(arr));
+  keys.assign(values, values + jl_array_len(arr));
+  return true;
+}
+
+void JuliaSortFilterProxyModel::source_reset()
+{
+  std::vector<int> rows;
+  compute_rows(rows);
+  set_rows(std::move(rows));
+  endResetModel();
+}
+
+// Insert the rows of the given list that are not shown yet. Returns false without changing anything if the list does
+// not keep the current rows in the same order, or if the new rows are scattered over too many ranges.
+bool JuliaSortFilterProxyModel::insert_proxy_rows(const std::vector<int>& rows)
+{
+  // Ranges of inserted rows, as position in rows and length
+  std::vector<std::pair<int, int>> ranges;
+  std::size_t nb_kept = 0;
+  for(std::size_t i = 0; i != rows.size(); ++i)
+  {
+    if(nb_kept != m_proxy_to_source.size() && rows[i] == m_proxy_to_source[nb_kept])
+    {
+      ++nb_kept;
+    }
+    else if(!ranges.empty() && ranges.back().first + ranges.back().second == int(i))
+    {
+      ++ranges.back().second;
+    }
+    else
+    {
+      ranges.emplace_back(int(i), 1);
+    }
+  }
+  if(nb_kept != m_proxy_to_source.size() || ranges.size() > max_mapped_ranges)
+  {
+    return false;
+  }
+
+  // In increasing order, so all rows before a range are in place when it is inserted
+  for(const auto& [position, length] : ranges)
+  {
+    beginInsertRows(QModelIndex(), position, position + length - 1);
+    m_proxy_to_source.insert(m_proxy_to_source.begin() + position, rows.begin() + position, rows.begin() + position + length);
+    update_source_to_proxy();
+    endInsertRows();
+  }
+  if(ranges.empty())
+  {
+    update_source_to_proxy();
+  }
+  return true;
+}
+
+// Remove the rows at the given proxy positions. Returns false without changing anything if they are scattered over too
+// many ranges.
+bool JuliaSortFilterProxyModel::remove_proxy_positions(std::vector<int>& positions)
+{
+  std::sort(positions.begin(), positions.end(), std::greater<int>());
+
+  // Ranges of proxy rows as first and last position, from the end so the positions of the next ones stay valid
+  std::vector<std::pair<int, int>> ranges;
+  for(const int position : positions)
+  {
+    if(!ranges.empty() && ranges.back().first == position + 1)
+    {
+      ranges.back().first = position;
+    }
+    else
+    {
+      ranges.emplace_back(position, position);
+    }
+  }
+  if(ranges.size() > max_mapped_ranges)
+  {
+    return false;
+  }
+
+  for(const auto& [first_position, last_position] : ranges)
+  {
+    beginRemoveRows(QModelIndex(), first_position, last_position);
+    m_proxy_to_source.erase(m_proxy_to_source.begin() + first_position, m_proxy_to_source.begin() + last_position + 1);
+    update_source_to_proxy();
+    endRemoveRows();
+  }
+  return true;
+}
+
+// The rows are filtered and sorted again. If that only adds rows to the current ones, they are inserted in place,
+// otherwise the model is reset.
+void JuliaSortFilterProxyModel::source_rows_inserted(const QModelIndex&, int first, int last)
+{
+  const int count = last - first + 1;
+  for(int& source_row : m_proxy_to_source)
+  {
+    if(source_row >= first)
+    {
+      source_row += count;
+    }
+  }
+  std::vector<int> rows;
+  compute_rows(rows);
+  if(!insert_proxy_rows(rows))
+  {
+    reset_rows(std::move(rows));
+  }
+}
+
+void JuliaSortFilterProxyModel::source_rows_about_to_be_removed(const QModelIndex&, int first, int last)
+{
+  std::vector<int> positions;
+  for(int source_row = first; source_row <= last && source_row < int(m_source_to_proxy.size()); ++source_row)
+  {
+    if(m_source_to_proxy[source_row] >= 0)
+    {
+      positions.push_back(m_source_to_proxy[source_row]);
+    }
+  }
+  if(!remove_proxy_positions(positions))
+  {
+    m_reset_on_remove = true;
+    beginResetModel();
+  }
+}
+
+void JuliaSortFilterProxyModel::source_rows_removed(const QModelIndex&, int first, int last)
+{
+  if(m_reset_on_remove)
+  {
+    m_reset_on_remove = false;
+    source_reset();
+    return;
+  }
+  const int count = last - first + 1;
+  for(int& source_row : m_proxy_to_source)
+  {
+    if(source_row > last)
+    {
+      source_row -= count;
+    }
+  }
+  update_source_to_proxy();
+
+  // The sort order of the remaining rows is unchanged, but a filter may depend on the removed rows
+  if(!m_filter.empty())
+  {
+    std::vector<int> rows;
+    compute_rows(rows);
+    if(rows != m_proxy_to_source)
+    {
+      reset_rows(std::move(rows));
+    }
+  }
+}
+
+// Filter the changed source rows again, removing the rows that are now hidden and inserting the ones that are now
+// shown. New rows are put at the end when sorting, for the caller to reorder. Returns false if the model was reset.
+bool JuliaSortFilterProxyModel::refilter_rows(int first, int last, bool& rows_shown)
+{
+  rows_shown = false;
+  std::vector<uint8_t> keep;
+  if(!filter_mask(first, last, keep))
+  {
+    return true;
+  }
+
+  std::vector<int> hidden_positions;
+  std::vector<int> shown_rows;
+  for(int source_row = first; source_row <= last; ++source_row)
+  {
+    const int position = m_source_to_proxy[source_row];
+    const bool kept = keep[source_row - first] != 0;
+    if(position >= 0 && !kept)
+    {
+      hidden_positions.push_back(position);
+    }
+    else if(position < 0 && kept)
+    {
+      shown_rows.push_back(source_row);
+    }
+  }
+
+  std::vector<int> rows;
+  if(!remove_proxy_positions(hidden_positions))
+  {
+    compute_rows(rows);
+    reset_rows(std::move(rows));
+    return false;
+  }
+  if(shown_rows.empty())
+  {
+    return true;
+  }
+
+  // Without sorting, the rows are in source order
+  rows.reserve(m_proxy_to_source.size() + shown_rows.size());
+  if(m_sort_column < 0)
+  {
+    std::merge(m_proxy_to_source.begin(), m_proxy_to_source.end(), shown_rows.begin(), shown_rows.end(), std::back_inserter(rows));
+  }
+  else
+  {
+    rows = m_proxy_to_source;
+    rows.insert(rows.end(), shown_rows.begin(), shown_rows.end());
+  }
+  if(!insert_proxy_rows(rows))
+  {
+    compute_rows(rows);
+    reset_rows(std::move(rows));
+    return false;
+  }
+  rows_shown = true;
+  return true;
+}
+
+void JuliaSortFilterProxyModel::source_data_changed(const QModelIndex& top_left, const QModelIndex& bottom_right, const QList<int>& roles)
+{
+  const int first_row = top_left.row();
+  const int last_row = std::min(bottom_right.row(), int(m_source_to_proxy.size()) - 1);
+  if(first_row > last_row)
+  {
+    return;
+  }
+
+  // The changed values may show or hide rows
+  bool rows_shown = false;
+  if(!m_filter.empty() && !refilter_rows(first_row, last_row, rows_shown))
+  {
+    return;
+  }
+  const bool sort_column_changed = m_sort_column >= top_left.column() && m_sort_column <= bottom_right.column();
+  if(m_sort_column >= 0 && (sort_column_changed || rows_shown))
+  {
+    std::vector<int> rows = m_proxy_to_source;
+    sort_by_column(rows);
+    if(rows != m_proxy_to_source)
+    {
+      reorder_rows(std::move(rows));
+    }
+  }
+
+  int first = std::numeric_limits<int>::max();
+  int last = -1;
+  for(int source_row = first_row; source_row <= last_row; ++source_row)
+  {
+    const int row = m_source_to_proxy[source_row];
+    if(row >= 0)
+    {
+      first = std::min(first, row);
+      last = std::max(last, row);
+    }
+  }
+  if(last >= 0)
+  {
+    emit dataChanged(index(first, top_left.column()), index(last, bottom_right.column()), roles);
+  }
+}
+
+} // namespace qmlwrap
@@ -0,0 +1,79 @@
+#ifndef QML_JULIASORTFILTERPROXYMODEL_H
+#define QML_JULIASORTFILTERPROXYMODEL_H
+
+#include <vector>
+
+#include <QAbstractProxyModel>
+#include <QPointer>
+
+#include "jlcxx/functions.hpp"
+
+#include "gc_root_arena.hpp"
+#include "julia_itemmodel.hpp"
+
+namespace qmlwrap
+{
+
+/// Sorted and filtered view on a JuliaItemModel, using a permutation of the source rows. Sort keys are read from the
+/// native columns of the source, or obtained for all rows at once from the sort_keys Julia function. The filter is
+/// a Julia function called once with the model data, returning a Vector{Bool} with the rows to keep. When source data
+/// changes, only the changed rows are filtered again, using filter_rows(filter, data, first, last) of the QML module,
+/// which returns the Vector{Bool} for the rows first:last.
+class JuliaSortFilterProxyModel : public QAbstractProxyModel
+{
+  Q_OBJECT
+public:
+  JuliaSortFilterProxyModel(JuliaItemModel* source, QObject* parent = nullptr);
+  ~JuliaSortFilterProxyModel();
+
+  void setSourceModel(QAbstractItemModel* source) override;
+  QModelIndex mapToSource(const QModelIndex& proxy_index) const override;
+  QModelIndex mapFromSource(const QModelIndex& source_index) const override;
+  QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+  QModelIndex parent(const QModelIndex& index) const override;
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+  bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+  // A negative column restores the source order
+  void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+  // Called from Julia
+  void set_filter(jl_value_t* filter);
+  void clear_filter();
+  // Filter and sort again, e.g. after changing a value the filter depends on
+  void invalidate();
+  int sort_column() const;
+
+private:
+  // Source rows to show, in order
+  void compute_rows(std::vector<int>& rows) const;
+  void sort_by_column(std::vector<int>& rows) const;
+  bool filter_mask(int first, int last, std::vector<uint8_t>& keep) const;
+  void set_rows(std::vector<int>&& rows);
+  void update_source_to_proxy();
+  void reset_rows(std::vector<int>&& rows);
+  void resort();
+  void reorder_rows(std::vector<int>&& rows);
+  bool insert_proxy_rows(const std::vector<int>& rows);
+  bool remove_proxy_positions(std::vector<int>& positions);
+  bool refilter_rows(int first, int last, bool& rows_shown);
+  bool sort_keys(int column, std::vector<double>& keys) const;
+  void source_reset();
+  void source_rows_inserted(const QModelIndex& parent, int first, int last);
+  void source_rows_about_to_be_removed(const QModelIndex& parent, int first, int last);
+  void source_rows_removed(const QModelIndex& parent, int first, int last);
+  void source_data_changed(const QModelIndex& top_left, const QModelIndex& bottom_right, const QList<int>& roles);
+
+  QPointer<JuliaItemModel> m_source;
+  std::vector<int> m_proxy_to_source;
+  std::vector<int> m_source_to_proxy; // -1 for rows that are filtered out
+  int m_sort_column = -1;
+  Qt::SortOrder m_sort_order = Qt::AscendingOrder;
+  GCRoot m_filter;
+  // Set when a removal touches too many proxy ranges and is handled as a reset
+  bool m_reset_on_remove = false;
+};
+
+} // namespace qmlwrap
+
+#endif
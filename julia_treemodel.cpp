@@ -0,0 +1,228 @@
+#include "julia_treemodel.hpp"
+#include "foreign_thread_manager.hpp"
+#include "jlqml.hpp"
+
+#include <QDebug>
+#include <QVariant>
+
+namespace qmlwrap
+{
+
+jl_module_t* JuliaTreeModel::m_qml_mod = nullptr;
+
+JuliaTreeModel::JuliaTreeModel(jl_value_t* root, QObject* parent) : QAbstractItemModel(parent), m_root(std::make_unique<Node>())
+{
+  assert(m_qml_mod != nullptr);
+  m_root->value = GCRoot(root, GCRootArena::Subsystem::ItemModel);
+  // Only the first level is loaded up front, the rest is fetched when the view expands a node
+  load_children(m_root.get());
+  m_root->children_loaded = true;
+}
+
+JuliaTreeModel::~JuliaTreeModel() = default;
+
+QModelIndex JuliaTreeModel::index(int row, int column, const QModelIndex& parent) const
+{
+  const Node* node = node_at(parent);
+  if(!node->children_loaded || row < 0 || row >= int(node->children.size()) || column < 0 || column >= columnCount())
+  {
+    return QModelIndex();
+  }
+  return createIndex(row, column, node->children[row].get());
+}
+
+QModelIndex JuliaTreeModel::parent(const QModelIndex& index) const
+{
+  if(!index.isValid())
+  {
+    return QModelIndex();
+  }
+  Node* parent_node = node_at(index)->parent;
+  if(parent_node == m_root.get())
+  {
+    return QModelIndex();
+  }
+  return createIndex(parent_node->row, 0, parent_node);
+}
+
+int JuliaTreeModel::rowCount(const QModelIndex& parent) const
+{
+  if(parent.column() > 0)
+  {
+    return 0;
+  }
+  const Node* node = node_at(parent);
+  return node->children_loaded ? int(node->children.size()) : 0;
+}
+
+int JuliaTreeModel::columnCount(const QModelIndex&) const
+{
+  if(m_column_count < 0)
+  {
+    GCGuard gc_guard;
+    static const jlcxx::JuliaFunction tree_columncount(jl_get_function(m_qml_mod, "tree_columncount"));
+    m_column_count = jlcxx::unbox<int>(tree_columncount(m_root->value.value()));
+  }
+  return m_column_count;
+}
+
+bool JuliaTreeModel::hasChildren(const QModelIndex& parent) const
+{
+  if(parent.column() > 0)
+  {
+    return false;
+  }
+  const Node* node = node_at(parent);
+  return node->children_loaded ? !node->children.empty() : node->has_children;
+}
+
+bool JuliaTreeModel::canFetchMore(const QModelIndex& parent) const
+{
+  const Node* node = node_at(parent);
+  return !node->children_loaded && node->has_children;
+}
+
+void JuliaTreeModel::fetchMore(const QModelIndex& parent)
+{
+  Node* node = node_at(parent);
+  if(node->children_loaded)
+  {
+    return;
+  }
+
+  // The children are only visible through rowCount and index once children_loaded is set
+  load_children(node);
+  const int nb_children = int(node->children.size());
+  if(nb_children == 0)
+  {
+    node->children_loaded = true;
+    node->has_children = false;
+    // Lets the view drop the expander of the node, hasChildren is now false
+    if(parent.isValid())
+    {
+      emit dataChanged(parent, parent);
+    }
+    return;
+  }
+  beginInsertRows(parent, 0, nb_children - 1);
+  node->children_loaded = true;
+  endInsertRows();
+}
+
+QVariant JuliaTreeModel::data(const QModelIndex& index, int role) const
+{
+  if(!index.isValid())
+  {
+    return QVariant();
+  }
+  GCGuard gc_guard;
+  static const jlcxx::JuliaFunction tree_data(jl_get_function(m_qml_mod, "tree_data"));
+  jl_value_t* result = tree_data(node_at(index)->value.value(), static_cast<int>(role), index.column()+1);
+  if(result == nullptr)
+  {
+    return QVariant();
+  }
+  return jlcxx::unbox<QVariant&>(result);
+}
+
+QHash<int, QByteArray> JuliaTreeModel::roleNames() const
+{
+  if(!m_role_names_valid)
+  {
+    // tree_rolenames is optional, the default Qt roles are used if it is not defined
+    GCGuard gc_guard;
+    static jl_function_t* tree_rolenames_f = jl_get_function(m_qml_mod, "tree_rolenames");
+    if(tree_rolenames_f == nullptr)
+    {
+      m_role_names = QAbstractItemModel::roleNames();
+    }
+    else
+    {
+      static const jlcxx::JuliaFunction tree_rolenames(tree_rolenames_f);
+      m_role_names = jlcxx::unbox<QHash<int, QByteArray>>(tree_rolenames(m_root->value.value()));
+    }
+    m_role_names_valid = true;
+  }
+  return m_role_names;
+}
+
+void JuliaTreeModel::reload()
+{
+  beginResetModel();
+  m_root->children.clear();
+  m_loaded_node_count = 0;
+  m_column_count = -1;
+  m_role_names_valid = false;
+  load_children(m_root.get());
+  m_root->children_loaded = true;
+  endResetModel();
+}
+
+jl_value_t* JuliaTreeModel::get_julia_root() const
+{
+  return m_root->value.value();
+}
+
+int JuliaTreeModel::loaded_node_count() const
+{
+  return m_loaded_node_count;
+}
+
+JuliaTreeModel::Node* JuliaTreeModel::node_at(const QModelIndex& index) const
+{
+  return index.isValid() ? static_cast<Node*>(index.internalPointer()) : m_root.get();
+}
+
+void JuliaTreeModel::load_children(Node* node)
+{
+  GCGuard gc_guard;
+  static const jlcxx::JuliaFunction tree_children(jl_get_function(m_qml_mod, "tree_children"));
+  static const jlcxx::JuliaFunction tree_has_children(jl_get_function(m_qml_mod, "tree_has_children"));
+
+  jl_value_t* children = tree_children(node->value.value());
+  if(children == nullptr || !jl_is_array(children) || jl_array_ndims(reinterpret_cast<jl_array_t*>(children)) != 1
+    || jl_stored_inline(jl_array_eltype(children)))
+  {
+    qWarning() << "tree_children must return a Vector with boxed elements, such as a Vector{Any}";
+    return;
+  }
+  // Rooted until every child holds its own root, acquiring a root may allocate a new slab
+  const GCRoot children_root(children, GCRootArena::Subsystem::ItemModel);
+
+  jl_array_t* children_arr = reinterpret_cast<jl_array_t*>(children);
+  const int nb_children = int(jl_array_len(children_arr));
+  if(nb_children == 0)
+  {
+    return;
+  }
+
+  // Expandability of all children is asked in a single call
+  jl_value_t* has_children = tree_has_children(children);
+  // The flags are copied, since the Bool vector is not rooted while the children are
+  std::vector<uint8_t> has_children_flags;
+  if(has_children != nullptr && jl_is_array(has_children) && jl_array_eltype(has_children) == reinterpret_cast<jl_value_t*>(jl_bool_type)
+    && int(jl_array_len(reinterpret_cast<jl_array_t*>(has_children))) == nb_children)
+  {
+    const uint8_t* flags = static_cast<const uint8_t*>(julia_array_data(reinterpret_cast<jl_array_t*>(has_children)));
+    has_children_flags.assign(flags, flags + nb_children);
+  }
+  else
+  {
+    qWarning() << "tree_has_children must return a Vector{Bool} with one element per child";
+  }
+
+  node->children.reserve(nb_children);
+  for(int i = 0; i != nb_children; ++i)
+  {
+    auto child = std::make_unique<Node>();
+    child->parent = node;
+    child->row = i;
+    jl_value_t* value = jl_array_ptr_ref(children_arr, i);
+    child->value = GCRoot(value == nullptr ? jl_nothing : value, GCRootArena::Subsystem::ItemModel);
+    child->has_children = has_children_flags.empty() || has_children_flags[i] != 0;
+    node->children.push_back(std::move(child));
+  }
+  m_loaded_node_count += nb_children;
+}
+
+} // namespace qmlwrap
@@ -0,0 +1,71 @@
+#ifndef QML_JULIATREEMODEL_H
+#define QML_JULIATREEMODEL_H
+
+#include <memory>
+#include <vector>
+
+#include <QAbstractItemModel>
+
+#include "jlcxx/jlcxx.hpp"
+#include "jlcxx/functions.hpp"
+
+#include "gc_root_arena.hpp"
+
+namespace qmlwrap
+{
+
+/// Tree of Julia values, loaded lazily. The children of a node are only requested when a view expands it, using the
+/// Julia functions tree_children(node), returning a Vector of child nodes, and tree_has_children(children), returning a
+/// Vector{Bool} telling which of the children can be expanded. Values are obtained with tree_data(node, role, column).
+class JuliaTreeModel : public QAbstractItemModel
+{
+  Q_OBJECT
+public:
+  static jl_module_t* m_qml_mod;
+
+  JuliaTreeModel(jl_value_t* root, QObject* parent = nullptr);
+  ~JuliaTreeModel();
+
+  QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+  QModelIndex parent(const QModelIndex& index) const override;
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+  bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+  bool canFetchMore(const QModelIndex& parent) const override;
+  void fetchMore(const QModelIndex& parent) override;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+  QHash<int,QByteArray> roleNames() const override;
+
+  // Called from Julia
+  // Drop all loaded nodes and load the children of the root again
+  void reload();
+  jl_value_t* get_julia_root() const;
+  // Number of nodes that were loaded so far, excluding the root
+  int loaded_node_count() const;
+
+private:
+  // Node handles are stored as internal pointer of the indexes and stay valid until reload
+  struct Node
+  {
+    Node* parent = nullptr;
+    int row = 0;
+    GCRoot value; // each node roots its own value, so Julia may modify the vector returned by tree_children
+    bool has_children = true;
+    bool children_loaded = false;
+    std::vector<std::unique_ptr<Node>> children;
+  };
+
+  Node* node_at(const QModelIndex& index) const;
+  // Fetch the children from Julia, without emitting any signal
+  void load_children(Node* node);
+
+  std::unique_ptr<Node> m_root;
+  mutable int m_column_count = -1;
+  mutable QHash<int,QByteArray> m_role_names;
+  mutable bool m_role_names_valid = false;
+  int m_loaded_node_count = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,261 @@
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <QDebug>
+
+#include "foreign_thread_manager.hpp"
+#include "jlqml.hpp"
+#include "julia_typed_function.hpp"
+#include "string_conversion.hpp"
+
+namespace qmlwrap
+{
+
+namespace
+{
+  using ValueType = JuliaTypedFunction::ValueType;
+
+  ValueType value_type(jl_value_t* t, bool is_result)
+  {
+    if(t == (jl_value_t*)jl_float64_type)
+    {
+      return ValueType::Float64;
+    }
+    if(t == (jl_value_t*)jl_int64_type)
+    {
+      return ValueType::Int64;
+    }
+    if(t == (jl_value_t*)jl_bool_type)
+    {
+      return ValueType::Bool;
+    }
+    static jl_value_t* cstring_type = jl_get_global(jl_base_module, jl_symbol("Cstring"));
+    if(!is_result && t == cstring_type)
+    {
+      return ValueType::Cstring;
+    }
+    if(is_result && t == (jl_value_t*)jl_nothing_type)
+    {
+      return ValueType::Nothing;
+    }
+    if(is_result && t == (jl_value_t*)jl_any_type)
+    {
+      return ValueType::Any;
+    }
+    const char* type_name = jl_is_datatype(t) ? jl_typename_str(t) : nullptr;
+    throw std::runtime_error(std::string("Unsupported type ") + (type_name != nullptr ? type_name : "?") + " in the signature of a typed function");
+  }
+
+  // Converted argument, kept alive until the call returns
+  template<typename T>
+  struct Argument;
+
+  template<>
+  struct Argument<double>
+  {
+    Argument(const QVariant& v) : value(v.toDouble()) {}
+    double value;
+  };
+
+  template<>
+  struct Argument<int64_t>
+  {
+    Argument(const QVariant& v) : value(v.toLongLong()) {}
+    int64_t value;
+  };
+
+  template<>
+  struct Argument<bool>
+  {
+    Argument(const QVariant& v) : value(v.toBool()) {}
+    bool value;
+  };
+
+  template<>
+  struct Argument<const char*>
+  {
+    Argument(const QVariant& v) : bytes(v.toString().toUtf8()), value(bytes.constData()) {}
+    QByteArray bytes;
+    const char* value;
+  };
+
+  QVariant to_qvariant(double v) { return QVariant(v); }
+  QVariant to_qvariant(int64_t v) { return QVariant(qlonglong(v)); }
+  QVariant to_qvariant(bool v) { return QVariant(v); }
+
+  // Common types are converted here, other Julia values are passed on to QML as is
+  QVariant to_qvariant(jl_value_t* v)
+  {
+    if(v == nullptr || v == jl_nothing)
+    {
+      return QVariant();
+    }
+    if(jl_typeis(v, jl_float64_type))
+    {
+      return QVariant(jl_unbox_float64(v));
+    }
+    if(jl_typeis(v, jl_int64_type))
+    {
+      return QVariant(qlonglong(jl_unbox_int64(v)));
+    }
+    if(jl_typeis(v, jl_bool_type))
+    {
+      return QVariant(jl_unbox_bool(v) != 0);
+    }
+    if(jl_is_string(v))
+    {
+      return QVariant(julia_to_qstring(v));
+    }
+    if(jl_isa(v, (jl_value_t*)jlcxx::julia_base_type<QVariant>()))
+    {
+      return jlcxx::unbox<QVariant&>(v);
+    }
+    // The result is only referenced from here until it is rooted. The frame is popped before rethrowing if rooting
+    // fails.
+    QVariant result;
+    JL_GC_PUSH1(&v);
+    try
+    {
+      result = QVariant::fromValue(qvariant_any_t(v));
+    }
+    catch(...)
+    {
+      JL_GC_POP();
+      throw;
+    }
+    JL_GC_POP();
+    return result;
+  }
+
+  // The arguments and the result are converted outside of the call to f, so the conversion time is profiled apart
+  template<typename R, typename... ArgsT, std::size_t... I>
+  QVariant invoke_impl(void* fptr, const QVariant* args, CallProfile::Timer& timer, std::index_sequence<I...>)
+  {
+    auto f = reinterpret_cast<R(*)(ArgsT...)>(fptr);
+    timer.begin_conversion();
+    std::tuple<Argument<ArgsT>...> arguments{args[I]...};
+    timer.end_conversion();
+    if constexpr (std::is_void_v<R>)
+    {
+      f(std::get<I>(arguments).value...);
+      return QVariant();
+    }
+    else
+    {
+      const R result = f(std::get<I>(arguments).value...);
+      timer.begin_conversion();
+      QVariant converted = to_qvariant(result);
+      timer.end_conversion();
+      return converted;
+    }
+  }
+
+  template<typename R, typename... ArgsT>
+  QVariant invoke(void* fptr, const QVariant* args, CallProfile::Timer& timer)
+  {
+    return invoke_impl<R, ArgsT...>(fptr, args, timer, std::index_sequence_for<ArgsT...>());
+  }
+
+  // Instantiates invoke for the argument types, adding one argument at a time
+  template<typename R, typename... ArgsT>
+  JuliaTypedFunction::invoker_t make_invoker(const std::vector<ValueType>& types)
+  {
+    constexpr std::size_t nb_args = sizeof...(ArgsT);
+    if(types.size() == nb_args)
+    {
+      return &invoke<R, ArgsT...>;
+    }
+    if constexpr (nb_args < JuliaTypedFunction::max_arguments)
+    {
+      switch(types[nb_args])
+      {
+        case ValueType::Float64:
+          return make_invoker<R, ArgsT..., double>(types);
+        case ValueType::Int64:
+          return make_invoker<R, ArgsT..., int64_t>(types);
+        case ValueType::Bool:
+          return make_invoker<R, ArgsT..., bool>(types);
+        case ValueType::Cstring:
+          return make_invoker<R, ArgsT..., const char*>(types);
+        default:
+          break;
+      }
+    }
+    throw std::runtime_error("Unsupported signature for a typed function");
+  }
+
+  JuliaTypedFunction::invoker_t make_invoker(ValueType result_type, const std::vector<ValueType>& types)
+  {
+    switch(result_type)
+    {
+      case ValueType::Float64:
+        return make_invoker<double>(types);
+      case ValueType::Int64:
+        return make_invoker<int64_t>(types);
+      case ValueType::Bool:
+        return make_invoker<bool>(types);
+      case ValueType::Nothing:
+        return make_invoker<void>(types);
+      case ValueType::Any:
+        return make_invoker<jl_value_t*>(types);
+      default:
+        break;
+    }
+    throw std::runtime_error("Unsupported result type for a typed function");
+  }
+}
+
+JuliaTypedFunction::JuliaTypedFunction(const QString& name, jlcxx::SafeCFunction f, QObject* parent) : QObject(parent), m_name(name), m_fptr(f.fptr)
+{
+  const int nb_arguments = int(jl_array_len(f.argtypes));
+  if(nb_arguments > max_arguments)
+  {
+    throw std::runtime_error("Typed function " + name.toStdString() + " has more than " + std::to_string(max_arguments) + " arguments");
+  }
+  std::vector<ValueType> types;
+  for(int i = 0; i != nb_arguments; ++i)
+  {
+    types.push_back(value_type(jl_array_ptr_ref(f.argtypes, i), false));
+  }
+  m_nb_arguments = nb_arguments;
+  m_invoker = make_invoker(value_type((jl_value_t*)f.return_type, true), types);
+}
+
+QVariant JuliaTypedFunction::call0()
+{
+  return call(nullptr, 0);
+}
+
+QVariant JuliaTypedFunction::call1(const QVariant& arg1)
+{
+  return call(&arg1, 1);
+}
+
+QVariant JuliaTypedFunction::call2(const QVariant& arg1, const QVariant& arg2)
+{
+  const QVariant args[] = {arg1, arg2};
+  return call(args, 2);
+}
+
+QVariant JuliaTypedFunction::call3(const QVariant& arg1, const QVariant& arg2, const QVariant& arg3)
+{
+  const QVariant args[] = {arg1, arg2, arg3};
+  return call(args, 3);
+}
+
+QVariant JuliaTypedFunction::call(const QVariant* args, int nb_args)
+{
+  if(nb_args != m_nb_arguments)
+  {
+    qWarning() << "Typed function" << m_name << "takes" << m_nb_arguments << "arguments, got" << nb_args;
+    return QVariant();
+  }
+  CallProfile::Timer timer(m_profile);
+  GCGuard gc_guard("JuliaTypedFunction::call");
+  timer.entered();
+  return m_invoker(m_fptr, args, timer);
+}
+
+} // namespace qmlwrap
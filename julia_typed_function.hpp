@@ -0,0 +1,58 @@
+#ifndef QML_JULIA_TYPED_FUNCTION_H
+#define QML_JULIA_TYPED_FUNCTION_H
+
+#include "jlcxx/jlcxx.hpp"
+#include "jlcxx/functions.hpp"
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+
+#include "call_profile.hpp"
+
+namespace qmlwrap
+{
+
+/// Julia function with a signature fixed by its cfunction, called from QML without packing the arguments in a list.
+/// Arguments can be Float64, Int64, Bool or Cstring, the result one of these (except Cstring), Nothing or Any.
+class JuliaTypedFunction : public QObject
+{
+  Q_OBJECT
+public:
+  enum class ValueType
+  {
+    Float64,
+    Int64,
+    Bool,
+    Cstring,
+    Nothing,
+    Any
+  };
+
+  static constexpr int max_arguments = 3;
+  using invoker_t = QVariant (*)(void*, const QVariant*, CallProfile::Timer&);
+
+  JuliaTypedFunction(const QString& name, jlcxx::SafeCFunction f, QObject* parent);
+
+  Q_INVOKABLE QVariant call0();
+  Q_INVOKABLE QVariant call1(const QVariant& arg1);
+  Q_INVOKABLE QVariant call2(const QVariant& arg1, const QVariant& arg2);
+  Q_INVOKABLE QVariant call3(const QVariant& arg1, const QVariant& arg2, const QVariant& arg3);
+
+  const QString& name() const { return m_name; }
+  int nb_arguments() const { return m_nb_arguments; }
+  CallProfile& profile() { return m_profile; }
+
+private:
+  QVariant call(const QVariant* args, int nb_args);
+
+  QString m_name;
+  void* m_fptr;
+  int m_nb_arguments;
+  invoker_t m_invoker;
+  CallProfile m_profile;
+};
+
+} // namespace qmlwrap
+
+#endif
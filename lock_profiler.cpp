@@ -0,0 +1,176 @@
+#include "lock_profiler.hpp"
+#include "duration_histogram.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QThread>
+
+namespace qmlwrap
+{
+
+namespace
+{
+  constexpr int max_slots = 64;
+
+  struct Slot
+  {
+    std::atomic<const char*> tag{nullptr}; // published last, after depth is set
+    int depth = 0;
+    DurationHistogram wait;
+    DurationHistogram hold;
+  };
+
+  struct ThreadRecord
+  {
+    QString thread_name;
+    Slot slots[max_slots];
+    int nb_slots = 0;
+
+    Slot& slot(const char* tag, int depth)
+    {
+      for(int i = 0; i != nb_slots; ++i)
+      {
+        Slot& s = slots[i];
+        const char* slot_tag = s.tag.load(std::memory_order_relaxed);
+        if(s.depth == depth && (slot_tag == tag || std::strcmp(slot_tag, tag) == 0))
+        {
+          return s;
+        }
+      }
+      // The last slot collects everything once the others are used
+      if(nb_slots == max_slots - 1)
+      {
+        tag = "other";
+        depth = -1;
+        if(slots[nb_slots].tag.load(std::memory_order_relaxed) != nullptr)
+        {
+          return slots[nb_slots];
+        }
+      }
+      Slot& s = slots[nb_slots];
+      s.depth = depth;
+      s.tag.store(tag, std::memory_order_release);
+      if(nb_slots != max_slots - 1)
+      {
+        ++nb_slots;
+      }
+      return s;
+    }
+  };
+
+  // Records are never deleted, so stats can read them while their thread is gone
+  std::mutex g_records_mutex;
+  std::vector<std::unique_ptr<ThreadRecord>> g_records;
+  thread_local ThreadRecord* t_record = nullptr;
+
+  ThreadRecord& thread_record()
+  {
+    if(t_record == nullptr)
+    {
+      auto record = std::make_unique<ThreadRecord>();
+      record->thread_name = QThread::currentThread()->objectName();
+      if(record->thread_name.isEmpty())
+      {
+        record->thread_name = QThread::isMainThread() ? QStringLiteral("main") : QStringLiteral("thread 0x") + QString::number(quintptr(QThread::currentThreadId()), 16);
+      }
+      t_record = record.get();
+      std::lock_guard<std::mutex> lock(g_records_mutex);
+      g_records.push_back(std::move(record));
+    }
+    return *t_record;
+  }
+
+  template<typename F>
+  void for_each_slot(F&& f)
+  {
+    std::lock_guard<std::mutex> lock(g_records_mutex);
+    for(const std::unique_ptr<ThreadRecord>& record : g_records)
+    {
+      for(Slot& slot : record->slots)
+      {
+        const char* tag = slot.tag.load(std::memory_order_acquire);
+        if(tag != nullptr)
+        {
+          f(*record, slot, tag);
+        }
+      }
+    }
+  }
+}
+
+std::atomic<bool> LockProfiler::m_enabled{false};
+
+void LockProfiler::set_enabled(bool enabled)
+{
+  m_enabled = enabled;
+}
+
+uint64_t LockProfiler::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LockProfiler::record(const char* tag, int depth, uint64_t wait_ns, uint64_t hold_ns)
+{
+  Slot& slot = thread_record().slot(tag, depth);
+  // The lock is only taken at depth 0, nested levels never wait
+  if(depth == 0)
+  {
+    slot.wait.record_single_writer(wait_ns);
+  }
+  slot.hold.record_single_writer(hold_ns);
+}
+
+QVariantList LockProfiler::stats()
+{
+  QVariantList result;
+  for_each_slot([&result] (const ThreadRecord& record, const Slot& slot, const char* tag)
+  {
+    QVariantMap entry;
+    entry["thread"] = record.thread_name;
+    entry["tag"] = QString::fromUtf8(tag);
+    entry["depth"] = slot.depth;
+    entry["count"] = qulonglong(slot.hold.count());
+    entry["wait_total_ns"] = qulonglong(slot.wait.total_ns());
+    entry["wait_max_ns"] = qulonglong(slot.wait.max_ns());
+    entry["wait_histogram"] = slot.wait.buckets();
+    entry["hold_total_ns"] = qulonglong(slot.hold.total_ns());
+    entry["hold_max_ns"] = qulonglong(slot.hold.max_ns());
+    entry["hold_histogram"] = slot.hold.buckets();
+    result.push_back(entry);
+  });
+  return result;
+}
+
+QString LockProfiler::report()
+{
+  QString result = QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+    .arg(QStringLiteral("thread"), -20).arg(QStringLiteral("tag"), -28).arg(QStringLiteral("depth"), 5).arg(QStringLiteral("count"), 10)
+    .arg(QStringLiteral("wait us"), 10).arg(QStringLiteral("wait p99"), 10).arg(QStringLiteral("wait max"), 10).arg(QStringLiteral("hold us"), 10).arg(QStringLiteral("hold p99"), 10);
+  for_each_slot([&result] (const ThreadRecord& record, const Slot& slot, const char* tag)
+  {
+    const uint64_t count = slot.hold.count();
+    const double wait_us = slot.wait.total_ns() * 1e-3;
+    const double hold_us = slot.hold.total_ns() * 1e-3;
+    result += QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+      .arg(record.thread_name, -20).arg(QString::fromUtf8(tag), -28).arg(slot.depth, 5).arg(qulonglong(count), 10)
+      .arg(wait_us, 10, 'f', 1).arg(slot.wait.quantile(0.99) * 1e-3, 10, 'f', 1).arg(slot.wait.max_ns() * 1e-3, 10, 'f', 1)
+      .arg(hold_us, 10, 'f', 1).arg(slot.hold.quantile(0.99) * 1e-3, 10, 'f', 1);
+  });
+  return result;
+}
+
+void LockProfiler::reset()
+{
+  for_each_slot([] (const ThreadRecord&, Slot& slot, const char*)
+  {
+    slot.wait.clear();
+    slot.hold.clear();
+  });
+}
+
+} // namespace qmlwrap
@@ -0,0 +1,43 @@
+#ifndef QML_LOCK_PROFILER_H
+#define QML_LOCK_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <QString>
+#include <QVariant>
+
+namespace qmlwrap
+{
+
+/// Collects the time spent waiting for the Julia lock and holding it, per thread, per call site tag and per nesting depth.
+/// Each thread writes to its own histograms using relaxed atomics only, so recording never blocks.
+class LockProfiler
+{
+public:
+  // Deeper nesting levels are not recorded
+  static constexpr int max_depth = 8;
+
+  static bool enabled()
+  {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+  static void set_enabled(bool enabled);
+
+  // Monotonic time in nanoseconds
+  static uint64_t now();
+  static void record(const char* tag, int depth, uint64_t wait_ns, uint64_t hold_ns);
+
+  // One map per thread, tag and depth, with the totals and the log2 histograms of the wait and hold times
+  static QVariantList stats();
+  // Human readable summary of stats
+  static QString report();
+  static void reset();
+
+private:
+  static std::atomic<bool> m_enabled;
+};
+
+} // namespace qmlwrap
+
+#endif
@@ -28,7 +28,7 @@ public:
   }
   void render() override
   {
-    GCGuard gc_guard;
+    GCGuard gc_guard("MakieViewport::render");
     if(m_scene != nullptr)
     {
       m_scene_render_function(m_screen_ptr, m_scene);
@@ -96,34 +96,19 @@ MakieViewport::MakieViewport(QQuickItem *parent) : OpenGLViewport(parent, new Ma
 
 MakieViewport::~MakieViewport()
 {
-  if(m_screen != nullptr)
-  {
-    jlcxx::unprotect_from_gc(m_screen);
-  }
-  if(m_scene != nullptr)
-  {
-    jlcxx::unprotect_from_gc(m_scene);
-  }
 }
 
 qvariant_any_t MakieViewport::scene()
 {
-  if(m_scene == nullptr)
-  {
-    return std::make_shared<QVariantAny>(jl_nothing);
-  }
-  return std::make_shared<QVariantAny>(m_scene);
+  return m_scene_root;
 }
 
 void MakieViewport::setScene(qvariant_any_t scene)
 {
-  jl_value_t* scene_val = scene->value;
-  jlcxx::protect_from_gc(scene_val);
-  if(m_scene != nullptr)
-  {
-    jlcxx::unprotect_from_gc(m_scene);
-  }
-  m_scene = scene_val;
+  // Shares the root of the QVariant, so no Julia call is needed on the GUI thread
+  m_scene_root = scene;
+  // The renderer skips a null scene, an empty root would give nothing instead
+  m_scene = m_scene_root.empty() ? nullptr : m_scene_root.value();
 }
 
 void MakieViewport::setup_buffer(QOpenGLFramebufferObject* fbo)
@@ -132,7 +117,7 @@ void MakieViewport::setup_buffer(QOpenGLFramebufferObject* fbo)
   if(m_screen == nullptr)
   {
     m_screen = MakieSupport::instance().setup_screen(std::forward<QOpenGLFramebufferObject*>(fbo), window());
-    jlcxx::protect_from_gc(m_screen);
+    m_screen_root = GCRoot(m_screen, GCRootArena::Subsystem::Makie);
     
     connect(window(), &QQuickWindow::sceneGraphInvalidated, [this] ()
     {
@@ -28,6 +28,9 @@ private:
   // Screen created and used on the Julia side
   jl_value_t* m_screen = nullptr;
   jl_value_t* m_scene = nullptr;
+  // Keep the above alive, the render function refers to the raw pointers
+  GCRoot m_screen_root;
+  GCRoot m_scene_root;
   virtual void setup_buffer(QOpenGLFramebufferObject* fbo) override;
 };
 
@@ -0,0 +1,96 @@
+#ifndef QML_MPSC_QUEUE_H
+#define QML_MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace qmlwrap
+{
+
+/// Lock-free multiple producer, single consumer queue (Vyukov's intrusive algorithm with a stub node).
+/// push may be called from any thread, pop only from the consumer thread.
+template<typename T>
+class MpscQueue
+{
+public:
+  MpscQueue() : m_head(&m_stub), m_tail(&m_stub)
+  {
+  }
+
+  ~MpscQueue()
+  {
+    T value;
+    while(pop(value))
+    {
+    }
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  void push(T value)
+  {
+    push_node(new Node(std::move(value)));
+  }
+
+  // Returns false if the queue is empty, or if the next element is still being pushed
+  bool pop(T& value)
+  {
+    Node* tail = m_tail;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if(tail == &m_stub)
+    {
+      if(next == nullptr)
+      {
+        return false;
+      }
+      m_tail = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if(next == nullptr)
+    {
+      if(tail != m_head.load(std::memory_order_acquire))
+      {
+        return false;
+      }
+      // tail is the last node, put the stub behind it so it can be removed
+      push_node(&m_stub);
+      next = tail->next.load(std::memory_order_acquire);
+      if(next == nullptr)
+      {
+        return false;
+      }
+    }
+    m_tail = next;
+    value = std::move(tail->value);
+    delete tail;
+    return true;
+  }
+
+private:
+  struct Node
+  {
+    Node() = default;
+    explicit Node(T&& v) : value(std::move(v))
+    {
+    }
+    std::atomic<Node*> next = nullptr;
+    T value;
+  };
+
+  void push_node(Node* node)
+  {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* previous = m_head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  Node m_stub;
+  std::atomic<Node*> m_head;
+  Node* m_tail;
+};
+
+} // namespace qmlwrap
+
+#endif
@@ -89,7 +89,7 @@ void DefaultRenderFunction::setRenderFunction(jlcxx::SafeCFunction f)
 
 void DefaultRenderFunction::render()
 {
-  GCGuard gc_guard;
+  GCGuard gc_guard("OpenGLViewport::render");
   m_render_function();
 }
 
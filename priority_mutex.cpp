@@ -0,0 +1,45 @@
+#include "priority_mutex.hpp"
+
+namespace qmlwrap
+{
+
+void PriorityMutex::lock(JuliaPriority priority)
+{
+  const int level = static_cast<int>(priority);
+  std::unique_lock<std::mutex> guard(m_mutex);
+  const uint64_t ticket = m_next_ticket[level]++;
+  if(m_locked || m_serving[level] != ticket || has_waiters_above(priority))
+  {
+    ++m_nb_waiting[level];
+    m_condition.wait(guard, [this, level, ticket, priority] ()
+    {
+      return !m_locked && m_serving[level] == ticket && !has_waiters_above(priority);
+    });
+    --m_nb_waiting[level];
+  }
+  ++m_serving[level];
+  m_locked = true;
+}
+
+void PriorityMutex::unlock()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_locked = false;
+  }
+  m_condition.notify_all();
+}
+
+bool PriorityMutex::has_waiters_above(JuliaPriority priority) const
+{
+  for(int level = static_cast<int>(priority) + 1; level < nb_priorities; ++level)
+  {
+    if(m_nb_waiting[level].load(std::memory_order_relaxed) != 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace qmlwrap
@@ -0,0 +1,43 @@
+#ifndef QML_PRIORITY_MUTEX_H
+#define QML_PRIORITY_MUTEX_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace qmlwrap
+{
+
+/// Priority of an entry into Julia. Rendering, painting and calls from QML are High, background updates are Normal.
+enum class JuliaPriority
+{
+  Normal = 0,
+  High = 1
+};
+
+/// Mutex granting the lock to waiters with the highest priority first, and in arrival order for equal priorities
+class PriorityMutex
+{
+public:
+  void lock(JuliaPriority priority);
+  void unlock();
+
+  // True if a thread with a higher priority than the given one is waiting for the lock
+  bool has_waiters_above(JuliaPriority priority) const;
+
+private:
+  static constexpr int nb_priorities = 2;
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_locked = false;
+  // Tickets give the arrival order within each priority
+  uint64_t m_next_ticket[nb_priorities] = {};
+  uint64_t m_serving[nb_priorities] = {};
+  std::atomic<int> m_nb_waiting[nb_priorities] = {};
+};
+
+} // namespace qmlwrap
+
+#endif
@@ -0,0 +1,363 @@
+#include <QDebug>
+#include <QJSValue>
+#include <QVariantList>
+#include <QVariantMap>
+
+#include "jlqml.hpp"
+#include "qvariant_conversion.hpp"
+#include "string_conversion.hpp"
+
+namespace qmlwrap
+{
+
+namespace
+{
+  // Containers nested deeper than this are stored as is, which also stops the recursion on cyclic containers
+  constexpr int max_conversion_depth = 64;
+
+  QVariant to_qvariant(jl_value_t* v, int depth);
+
+  // Julia helpers for the containers that have no stable C layout, compiled on first use and never collected
+  jl_value_t* eval_helper(const char* source)
+  {
+    jl_value_t* f = jl_eval_string(source);
+    if(f == nullptr)
+    {
+      qWarning() << "Error compiling conversion helper" << source;
+      return nullptr;
+    }
+    jlcxx::protect_from_gc(f);
+    return f;
+  }
+
+  jl_value_t* dict_keys_values()
+  {
+    static jl_value_t* f = eval_helper("d -> (String[string(k) for k in keys(d)], Any[v for v in values(d)])");
+    return f;
+  }
+
+  jl_value_t* make_dict()
+  {
+    static jl_value_t* f = eval_helper("(k, v) -> Dict{String,Any}(zip(k, v))");
+    return f;
+  }
+
+  QVariant opaque_qvariant(jl_value_t* v)
+  {
+    return QVariant::fromValue(qvariant_any_t(v));
+  }
+
+  bool scalar_to_qvariant(jl_value_t* v, QVariant& result)
+  {
+    jl_value_t* t = jl_typeof(v);
+    if(t == (jl_value_t*)jl_float64_type)
+    {
+      result = jl_unbox_float64(v);
+    }
+    else if(t == (jl_value_t*)jl_int64_type)
+    {
+      result = qlonglong(jl_unbox_int64(v));
+    }
+    else if(t == (jl_value_t*)jl_bool_type)
+    {
+      result = jl_unbox_bool(v) != 0;
+    }
+    else if(t == (jl_value_t*)jl_int32_type)
+    {
+      result = int(jl_unbox_int32(v));
+    }
+    else if(t == (jl_value_t*)jl_float32_type)
+    {
+      result = jl_unbox_float32(v);
+    }
+    else if(t == (jl_value_t*)jl_uint64_type)
+    {
+      result = qulonglong(jl_unbox_uint64(v));
+    }
+    else if(t == (jl_value_t*)jl_uint32_type)
+    {
+      result = uint(jl_unbox_uint32(v));
+    }
+    else if(jl_is_string(v))
+    {
+      result = julia_to_qstring(v);
+    }
+    else if(jl_is_symbol(v))
+    {
+      result = QString::fromUtf8(jl_symbol_name((jl_sym_t*)v));
+    }
+    else
+    {
+      return false;
+    }
+    return true;
+  }
+
+  template<typename T, typename QtT = T>
+  void append_elements(QVariantList& list, const void* data, size_t n)
+  {
+    const T* elements = static_cast<const T*>(data);
+    for(size_t i = 0; i != n; ++i)
+    {
+      list.push_back(QVariant(QtT(elements[i])));
+    }
+  }
+
+  // Newly boxed values, like isbits tuple fields, are only referenced from the stack and must be rooted.
+  // Creating a root for opaque_qvariant may throw, e.g. std::bad_alloc, so each GC frame is popped before rethrowing.
+  QVariant rooted_to_qvariant(jl_value_t* v, int depth)
+  {
+    QVariant result;
+    JL_GC_PUSH1(&v);
+    try
+    {
+      result = to_qvariant(v, depth);
+    }
+    catch(...)
+    {
+      JL_GC_POP();
+      throw;
+    }
+    JL_GC_POP();
+    return result;
+  }
+
+  QVariant array_to_qvariant(jl_array_t* arr, int depth)
+  {
+    jl_value_t* eltype = jl_tparam0(jl_typeof((jl_value_t*)arr));
+    const size_t n = jl_array_len(arr);
+    const void* data = julia_array_data(arr);
+    QVariantList list;
+    list.reserve(n);
+    // Elements of primitive types are read straight from the array memory
+    if(eltype == (jl_value_t*)jl_float64_type)
+    {
+      append_elements<double>(list, data, n);
+    }
+    else if(eltype == (jl_value_t*)jl_int64_type)
+    {
+      append_elements<int64_t, qlonglong>(list, data, n);
+    }
+    else if(eltype == (jl_value_t*)jl_int32_type)
+    {
+      append_elements<int32_t, int>(list, data, n);
+    }
+    else if(eltype == (jl_value_t*)jl_float32_type)
+    {
+      append_elements<float>(list, data, n);
+    }
+    else if(eltype == (jl_value_t*)jl_bool_type)
+    {
+      append_elements<uint8_t, bool>(list, data, n);
+    }
+    else if(!jl_stored_inline(eltype))
+    {
+      for(size_t i = 0; i != n; ++i)
+      {
+        list.push_back(to_qvariant(jl_array_ptr_ref(arr, i), depth));
+      }
+    }
+    else
+    {
+      return opaque_qvariant((jl_value_t*)arr);
+    }
+    return list;
+  }
+
+  QVariant dict_to_qvariant(jl_value_t* dict, int depth)
+  {
+    jl_value_t* helper = dict_keys_values();
+    jl_value_t* keys_values = helper == nullptr ? nullptr : jl_call1(helper, dict);
+    if(keys_values == nullptr)
+    {
+      return opaque_qvariant(dict);
+    }
+    QVariantMap result;
+    JL_GC_PUSH1(&keys_values);
+    try
+    {
+      jl_array_t* keys = (jl_array_t*)jl_get_nth_field(keys_values, 0);
+      jl_array_t* values = (jl_array_t*)jl_get_nth_field(keys_values, 1);
+      const size_t n = jl_array_len(keys);
+      for(size_t i = 0; i != n; ++i)
+      {
+        jl_value_t* key = jl_array_ptr_ref(keys, i);
+        result.insert(julia_to_qstring(key), to_qvariant(jl_array_ptr_ref(values, i), depth));
+      }
+    }
+    catch(...)
+    {
+      JL_GC_POP();
+      throw;
+    }
+    JL_GC_POP();
+    return result;
+  }
+
+  QVariant namedtuple_to_qvariant(jl_value_t* v, int depth)
+  {
+    jl_value_t* names = jl_tparam0(jl_typeof(v));
+    const size_t n = jl_nfields(v);
+    QVariantMap result;
+    for(size_t i = 0; i != n; ++i)
+    {
+      jl_sym_t* name = (jl_sym_t*)jl_get_nth_field(names, i);
+      result.insert(QString::fromUtf8(jl_symbol_name(name)), rooted_to_qvariant(jl_get_nth_field(v, i), depth));
+    }
+    return result;
+  }
+
+  QVariant to_qvariant(jl_value_t* v, int depth)
+  {
+    if(v == nullptr || v == jl_nothing)
+    {
+      return QVariant();
+    }
+    QVariant result;
+    if(scalar_to_qvariant(v, result))
+    {
+      return result;
+    }
+    if(depth == max_conversion_depth)
+    {
+      return opaque_qvariant(v);
+    }
+    ++depth;
+    if(jl_is_array(v) && jl_array_ndims((jl_array_t*)v) == 1)
+    {
+      return array_to_qvariant((jl_array_t*)v, depth);
+    }
+    if(jl_is_tuple(v))
+    {
+      const size_t n = jl_nfields(v);
+      QVariantList list;
+      list.reserve(n);
+      for(size_t i = 0; i != n; ++i)
+      {
+        list.push_back(rooted_to_qvariant(jl_get_nth_field(v, i), depth));
+      }
+      return list;
+    }
+    if(jl_is_namedtuple_type(jl_typeof(v)))
+    {
+      return namedtuple_to_qvariant(v, depth);
+    }
+    static jl_value_t* abstract_dict = jl_get_global(jl_base_module, jl_symbol("AbstractDict"));
+    if(jl_isa(v, abstract_dict))
+    {
+      return dict_to_qvariant(v, depth);
+    }
+    if(jl_isa(v, (jl_value_t*)jlcxx::julia_base_type<QVariant>()))
+    {
+      return jlcxx::unbox<QVariant&>(v);
+    }
+    return opaque_qvariant(v);
+  }
+
+  jl_value_t* list_to_julia(const QVariantList& list)
+  {
+    jl_array_t* arr = jl_alloc_vec_any(list.size());
+    JL_GC_PUSH1(&arr);
+    try
+    {
+      for(qsizetype i = 0; i != list.size(); ++i)
+      {
+        jl_array_ptr_set(arr, i, qvariant_to_julia(list[i]));
+      }
+    }
+    catch(...)
+    {
+      JL_GC_POP();
+      throw;
+    }
+    JL_GC_POP();
+    return (jl_value_t*)arr;
+  }
+
+  // Errors are reported as warnings, an exception must not unwind through the GC frames of the enclosing conversions
+  jl_value_t* map_to_julia(const QVariantMap& map)
+  {
+    jl_value_t* helper = make_dict();
+    if(helper == nullptr)
+    {
+      return jl_nothing;
+    }
+    jl_array_t* keys = jl_alloc_vec_any(map.size());
+    jl_array_t* values = nullptr;
+    JL_GC_PUSH2(&keys, &values);
+    values = jl_alloc_vec_any(map.size());
+    try
+    {
+      size_t i = 0;
+      for(auto it = map.constBegin(); it != map.constEnd(); ++it, ++i)
+      {
+        jl_array_ptr_set(keys, i, julia_string(it.key()));
+        jl_array_ptr_set(values, i, qvariant_to_julia(it.value()));
+      }
+    }
+    catch(...)
+    {
+      JL_GC_POP();
+      throw;
+    }
+    jl_value_t* result = jl_call2(helper, (jl_value_t*)keys, (jl_value_t*)values);
+    JL_GC_POP();
+    if(result == nullptr)
+    {
+      qWarning() << "Error converting QVariantMap to Dict";
+      return jl_nothing;
+    }
+    return result;
+  }
+}
+
+QVariant julia_to_qvariant(jl_value_t* v)
+{
+  return to_qvariant(v, 0);
+}
+
+jl_value_t* qvariant_to_julia(const QVariant& v)
+{
+  if(!v.isValid())
+  {
+    return jl_nothing;
+  }
+  const int id = v.metaType().id();
+  switch(id)
+  {
+    case QMetaType::Bool:
+      return jl_box_bool(v.toBool());
+    case QMetaType::Int:
+      return jl_box_int32(v.toInt());
+    case QMetaType::UInt:
+      return jl_box_uint32(v.toUInt());
+    case QMetaType::LongLong:
+      return jl_box_int64(v.toLongLong());
+    case QMetaType::ULongLong:
+      return jl_box_uint64(v.toULongLong());
+    case QMetaType::Double:
+      return jl_box_float64(v.toDouble());
+    case QMetaType::Float:
+      return jl_box_float32(v.toFloat());
+    case QMetaType::QString:
+      return julia_string(v.toString());
+    case QMetaType::QVariantList:
+    case QMetaType::QStringList:
+      return list_to_julia(v.toList());
+    case QMetaType::QVariantMap:
+      return map_to_julia(v.toMap());
+    default:
+      break;
+  }
+  if(id == qMetaTypeId<QJSValue>())
+  {
+    return qvariant_to_julia(v.value<QJSValue>().toVariant());
+  }
+  if(id == qMetaTypeId<qvariant_any_t>())
+  {
+    return v.value<qvariant_any_t>().value();
+  }
+  return jlcxx::box<QVariant>(v);
+}
+
+} // namespace qmlwrap
@@ -0,0 +1,22 @@
+#ifndef QML_QVARIANT_CONVERSION_H
+#define QML_QVARIANT_CONVERSION_H
+
+#include "jlcxx/jlcxx.hpp"
+
+#include <QVariant>
+
+namespace qmlwrap
+{
+
+// Convert a tree of Julia values in a single pass: AbstractDicts become QVariantMaps with string keys, Vectors and
+// Tuples become QVariantLists, NamedTuples become QVariantMaps. Numbers, Bool, String and Symbol are converted to the
+// corresponding QVariant, other values are stored as is. Containers nested more than 64 levels deep, including cyclic
+// ones, are stored as is too. The caller must be in Julia.
+QVariant julia_to_qvariant(jl_value_t* value);
+
+// Reverse of julia_to_qvariant, maps become Dict{String,Any} and lists Vector{Any}. The caller must be in Julia.
+jl_value_t* qvariant_to_julia(const QVariant& value);
+
+} // namespace qmlwrap
+
+#endif
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "row_diff.hpp"
+
+namespace qmlwrap
+{
+
+namespace
+{
+
+// Mark the elements of a and b that are part of their longest common subsequence. This is the basic
+// O((n+m)d) Myers algorithm, keeping the trace of the furthest reaching paths to backtrack.
+// Returns false if the edit distance exceeds max_edits.
+bool mark_common(const uint64_t* a, int n, const uint64_t* b, int m, int max_edits, char* a_kept, char* b_kept)
+{
+  const int max_d = std::min(n + m, std::max(max_edits, 0));
+  const int offset = max_d + 1;
+  std::vector<int> v(2*max_d + 3, 0);
+  // Copy of v[-d-1..d+1] at the start of iteration d
+  std::vector<std::vector<int>> trace;
+  int final_d = -1;
+  for(int d = 0; d <= max_d && final_d < 0; ++d)
+  {
+    trace.emplace_back(v.begin() + offset - d - 1, v.begin() + offset + d + 2);
+    for(int k = -d; k <= d; k += 2)
+    {
+      int x = (k == -d || (k != d && v[offset+k-1] < v[offset+k+1])) ? v[offset+k+1] : v[offset+k-1] + 1;
+      int y = x - k;
+      while(x < n && y < m && a[x] == b[y])
+      {
+        ++x;
+        ++y;
+      }
+      v[offset+k] = x;
+      if(x >= n && y >= m)
+      {
+        final_d = d;
+        break;
+      }
+    }
+  }
+  if(final_d < 0)
+  {
+    return false;
+  }
+
+  int x = n;
+  int y = m;
+  for(int d = final_d; d >= 0; --d)
+  {
+    const std::vector<int>& vd = trace[d];
+    auto v_at = [&vd, d] (int k) { return vd[k + d + 1]; };
+    const int k = x - y;
+    const int prev_k = (k == -d || (k != d && v_at(k-1) < v_at(k+1))) ? k+1 : k-1;
+    const int prev_x = v_at(prev_k);
+    const int prev_y = prev_x - prev_k;
+    while(x > prev_x && y > prev_y)
+    {
+      --x;
+      --y;
+      a_kept[x] = 1;
+      b_kept[y] = 1;
+    }
+    x = prev_x;
+    y = prev_y;
+  }
+  return true;
+}
+
+int position_of(const std::vector<int>& rows, int row)
+{
+  return int(std::find(rows.begin(), rows.end(), row) - rows.begin());
+}
+
+}
+
+bool compute_row_edits(const uint64_t* old_keys, std::size_t nb_old, const uint64_t* new_keys, std::size_t nb_new, int max_edits, std::vector<RowEdit>& edits,
+  const uint64_t* old_hashes, const uint64_t* new_hashes)
+{
+  edits.clear();
+
+  // Unchanged rows at the start and the end are kept without running the diff on them
+  std::size_t prefix = 0;
+  while(prefix < nb_old && prefix < nb_new && old_keys[prefix] == new_keys[prefix])
+  {
+    ++prefix;
+  }
+  std::size_t suffix = 0;
+  while(suffix < nb_old - prefix && suffix < nb_new - prefix && old_keys[nb_old-1-suffix] == new_keys[nb_new-1-suffix])
+  {
+    ++suffix;
+  }
+
+  std::vector<char> old_kept(nb_old, 1);
+  std::vector<char> new_kept(nb_new, 1);
+  const int n = int(nb_old - prefix - suffix);
+  const int m = int(nb_new - prefix - suffix);
+  std::fill_n(old_kept.begin() + prefix, n, 0);
+  std::fill_n(new_kept.begin() + prefix, m, 0);
+  if(!mark_common(old_keys + prefix, n, new_keys + prefix, m, max_edits, old_kept.data() + prefix, new_kept.data() + prefix))
+  {
+    return false;
+  }
+
+  // Old row matching each row of the new list, or -1 for inserted rows. Kept rows match in order.
+  std::vector<int> new_match(nb_new, -1);
+  {
+    std::size_t i = 0;
+    for(std::size_t j = 0; j != nb_new; ++j)
+    {
+      if(!new_kept[j])
+      {
+        continue;
+      }
+      while(!old_kept[i])
+      {
+        ++i;
+      }
+      new_match[j] = int(i++);
+    }
+  }
+
+  // A row that is removed and inserted again, with a key that is unique among the changed rows, is moved instead
+  std::unordered_map<uint64_t, int> removed_count;
+  std::unordered_map<uint64_t, int> removed_at;
+  std::unordered_map<uint64_t, int> inserted_count;
+  for(std::size_t i = 0; i != nb_old; ++i)
+  {
+    if(!old_kept[i])
+    {
+      ++removed_count[old_keys[i]];
+      removed_at[old_keys[i]] = int(i);
+    }
+  }
+  for(std::size_t j = 0; j != nb_new; ++j)
+  {
+    if(!new_kept[j])
+    {
+      ++inserted_count[new_keys[j]];
+    }
+  }
+  std::vector<char> old_moved(nb_old, 0);
+  for(std::size_t j = 0; j != nb_new; ++j)
+  {
+    const uint64_t key = new_keys[j];
+    if(!new_kept[j] && inserted_count[key] == 1 && removed_count[key] == 1)
+    {
+      new_match[j] = removed_at[key];
+      old_moved[removed_at[key]] = 1;
+    }
+  }
+
+  // Removals, from the last row to the first so the positions of the remaining removals don't change
+  std::vector<int> rows; // current list, identified by the index in the old list
+  rows.reserve(nb_old);
+  for(int i = int(nb_old) - 1; i >= 0;)
+  {
+    if(old_kept[i] || old_moved[i])
+    {
+      --i;
+      continue;
+    }
+    int first = i;
+    while(first > 0 && !old_kept[first-1] && !old_moved[first-1])
+    {
+      --first;
+    }
+    edits.push_back(RowEdit{RowEdit::Remove, first, i - first + 1, 0});
+    i = first - 1;
+  }
+  for(std::size_t i = 0; i != nb_old; ++i)
+  {
+    if(old_kept[i] || old_moved[i])
+    {
+      rows.push_back(int(i));
+    }
+  }
+
+  // Moves: each moved row is put right after its predecessor in the new list, which yields the new order
+  int predecessor = -1;
+  for(std::size_t j = 0; j != nb_new; ++j)
+  {
+    const int row = new_match[j];
+    if(row == -1)
+    {
+      continue;
+    }
+    if(old_moved[row])
+    {
+      const int from = position_of(rows, row);
+      rows.erase(rows.begin() + from);
+      const int to = predecessor == -1 ? 0 : position_of(rows, predecessor) + 1;
+      rows.insert(rows.begin() + to, row);
+      if(to != from)
+      {
+        edits.push_back(RowEdit{RowEdit::Move, to, 1, from});
+      }
+    }
+    predecessor = row;
+  }
+
+  // Insertions, in increasing order of their final position
+  for(std::size_t j = 0; j != nb_new;)
+  {
+    if(new_match[j] != -1)
+    {
+      ++j;
+      continue;
+    }
+    std::size_t last = j;
+    while(last + 1 != nb_new && new_match[last+1] == -1)
+    {
+      ++last;
+    }
+    edits.push_back(RowEdit{RowEdit::Insert, int(j), int(last - j + 1), int(j)});
+    j = last + 1;
+  }
+
+  // Replacements of the rows that came from the old list, whose contents may differ
+  const bool has_hashes = old_hashes != nullptr && new_hashes != nullptr;
+  auto replaced = [&] (std::size_t j)
+  {
+    return new_match[j] != -1 && (!has_hashes || old_hashes[new_match[j]] != new_hashes[j]);
+  };
+  for(std::size_t j = 0; j != nb_new;)
+  {
+    if(!replaced(j))
+    {
+      ++j;
+      continue;
+    }
+    std::size_t last = j;
+    while(last + 1 != nb_new && replaced(last+1))
+    {
+      ++last;
+    }
+    edits.push_back(RowEdit{RowEdit::Replace, int(j), int(last - j + 1), int(j)});
+    j = last + 1;
+  }
+
+  return true;
+}
+
+} // namespace qmlwrap
@@ -0,0 +1,35 @@
+#ifndef QML_ROW_DIFF_H
+#define QML_ROW_DIFF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace qmlwrap
+{
+
+/// Single step of an edit script that turns a list of rows into another one
+struct RowEdit
+{
+  enum Kind { Remove, Move, Insert, Replace };
+
+  Kind kind;
+  // 0-based position in the list as it is when the edit is applied. For moves, this is the position after the move.
+  int first;
+  int count;
+  // Insert: first 0-based position of the inserted rows in the new list. Move: position of the row before the move.
+  int source;
+};
+
+/// Compute the edits turning the rows identified by old_keys into the rows identified by new_keys, using the Myers
+/// diff algorithm. Rows are first removed (starting from the end), then moved one by one and finally inserted.
+/// The rows that were kept or moved are then replaced by their new contents, in ranges of the final list whose source
+/// is the same position in the new list. With content hashes, only the rows with a different hash are replaced.
+/// Returns false if more than max_edits rows need to be inserted or removed, in which case edits is left empty.
+/// A negative max_edits is treated as 0.
+bool compute_row_edits(const uint64_t* old_keys, std::size_t nb_old, const uint64_t* new_keys, std::size_t nb_new, int max_edits, std::vector<RowEdit>& edits,
+  const uint64_t* old_hashes = nullptr, const uint64_t* new_hashes = nullptr);
+
+} // namespace qmlwrap
+
+#endif
@@ -0,0 +1,162 @@
+#include "string_conversion.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace qmlwrap
+{
+
+namespace
+{
+  inline bool is_high_surrogate(char16_t c)
+  {
+    return (c & 0xFC00) == 0xD800;
+  }
+
+  inline bool is_low_surrogate(char16_t c)
+  {
+    return (c & 0xFC00) == 0xDC00;
+  }
+
+  // Number of leading code units below 0x80
+  size_t ascii_prefix(const char16_t* src, size_t n)
+  {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i non_ascii = _mm_set1_epi16(short(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 8 <= n; i += 8)
+    {
+      const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      if(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, non_ascii), zero)) != 0xFFFF)
+      {
+        break;
+      }
+    }
+#endif
+    while(i != n && src[i] < 0x80)
+    {
+      ++i;
+    }
+    return i;
+  }
+
+  // Copy n code units that are known to be ASCII
+  void narrow_ascii(const char16_t* src, size_t n, char* dst)
+  {
+    size_t i = 0;
+#ifdef __SSE2__
+    for(; i + 16 <= n; i += 16)
+    {
+      const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for(; i != n; ++i)
+    {
+      dst[i] = char(src[i]);
+    }
+  }
+
+  // Size of the buffer filled by utf16_to_utf8
+  size_t utf8_length(const char16_t* src, size_t n)
+  {
+    size_t length = 0;
+    size_t i = 0;
+    while(true)
+    {
+      const size_t nb_ascii = ascii_prefix(src + i, n - i);
+      length += nb_ascii;
+      i += nb_ascii;
+      if(i == n)
+      {
+        return length;
+      }
+      const char16_t c = src[i];
+      if(c < 0x800)
+      {
+        length += 2;
+      }
+      else if(is_high_surrogate(c) && i + 1 != n && is_low_surrogate(src[i + 1]))
+      {
+        length += 4;
+        ++i;
+      }
+      else
+      {
+        length += 3;
+      }
+      ++i;
+    }
+  }
+
+  void utf16_to_utf8(const char16_t* src, size_t n, char* dst)
+  {
+    size_t i = 0;
+    while(true)
+    {
+      const size_t nb_ascii = ascii_prefix(src + i, n - i);
+      narrow_ascii(src + i, nb_ascii, dst);
+      dst += nb_ascii;
+      i += nb_ascii;
+      if(i == n)
+      {
+        return;
+      }
+      char32_t c = src[i];
+      if(c < 0x800)
+      {
+        *dst++ = char(0xC0 | (c >> 6));
+        *dst++ = char(0x80 | (c & 0x3F));
+      }
+      else if(is_high_surrogate(c) && i + 1 != n && is_low_surrogate(src[i + 1]))
+      {
+        c = 0x10000 + ((c - 0xD800) << 10) + (src[i + 1] - 0xDC00);
+        *dst++ = char(0xF0 | (c >> 18));
+        *dst++ = char(0x80 | ((c >> 12) & 0x3F));
+        *dst++ = char(0x80 | ((c >> 6) & 0x3F));
+        *dst++ = char(0x80 | (c & 0x3F));
+        ++i;
+      }
+      else
+      {
+        if(is_high_surrogate(c) || is_low_surrogate(c))
+        {
+          c = 0xFFFD;
+        }
+        *dst++ = char(0xE0 | (c >> 12));
+        *dst++ = char(0x80 | ((c >> 6) & 0x3F));
+        *dst++ = char(0x80 | (c & 0x3F));
+      }
+      ++i;
+    }
+  }
+}
+
+jl_value_t* julia_string(const QString& s)
+{
+  const char16_t* src = reinterpret_cast<const char16_t*>(s.constData());
+  const size_t n = size_t(s.size());
+  const size_t length = utf8_length(src, n);
+  jl_value_t* result = jl_alloc_string(length);
+  char* dst = jl_string_data(result);
+  if(length == n)
+  {
+    narrow_ascii(src, n, dst);
+  }
+  else
+  {
+    utf16_to_utf8(src, n, dst);
+  }
+  return result;
+}
+
+QString julia_to_qstring(jl_value_t* s)
+{
+  // fromUtf8 has its own vectorized ASCII path and writes into a single allocation
+  return QString::fromUtf8(jl_string_data(s), qsizetype(jl_string_len(s)));
+}
+
+} // namespace qmlwrap
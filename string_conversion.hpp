@@ -0,0 +1,20 @@
+#ifndef QML_STRING_CONVERSION_H
+#define QML_STRING_CONVERSION_H
+
+#include "jlcxx/jlcxx.hpp"
+
+#include <QString>
+
+namespace qmlwrap
+{
+
+// Julia String holding s encoded as UTF-8, written straight into the memory of the new string. Runs of ASCII are
+// converted 16 code units at a time. Unpaired surrogates become U+FFFD. The caller must be in Julia.
+jl_value_t* julia_string(const QString& s);
+
+// QString from a Julia String
+QString julia_to_qstring(jl_value_t* s);
+
+} // namespace qmlwrap
+
+#endif
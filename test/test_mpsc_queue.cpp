@@ -0,0 +1,124 @@
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mpsc_queue.hpp"
+
+using namespace qmlwrap;
+
+namespace
+{
+
+struct Item
+{
+  int producer = -1;
+  int sequence = -1;
+};
+
+void check(bool condition, const std::string& message)
+{
+  if(!condition)
+  {
+    throw std::runtime_error(message);
+  }
+}
+
+void test_single_thread()
+{
+  MpscQueue<int> queue;
+  int value = 0;
+  check(!queue.pop(value), "a new queue is empty");
+  for(int i = 0; i != 10; ++i)
+  {
+    queue.push(i);
+  }
+  for(int i = 0; i != 10; ++i)
+  {
+    check(queue.pop(value) && value == i, "values come out in the order they were pushed");
+  }
+  check(!queue.pop(value), "the queue is empty after popping everything");
+
+  // The queue must stay usable after it was emptied, which puts the stub node back
+  queue.push(42);
+  check(queue.pop(value) && value == 42, "the queue is reusable after being emptied");
+}
+
+// Elements of each producer must come out in the order that producer pushed them
+void test_multiple_producers()
+{
+  constexpr int nb_producers = 4;
+  constexpr int nb_items = 100000;
+
+  MpscQueue<Item> queue;
+  std::vector<std::thread> producers;
+  for(int p = 0; p != nb_producers; ++p)
+  {
+    producers.emplace_back([&queue, p]()
+    {
+      for(int i = 0; i != nb_items; ++i)
+      {
+        queue.push(Item{p, i});
+      }
+    });
+  }
+
+  std::vector<int> next_sequence(nb_producers, 0);
+  int nb_popped = 0;
+  Item item;
+  while(nb_popped != nb_producers * nb_items)
+  {
+    if(!queue.pop(item))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    check(item.producer >= 0 && item.producer < nb_producers, "invalid producer");
+    check(item.sequence == next_sequence[item.producer], "elements of a producer came out of order");
+    ++next_sequence[item.producer];
+    ++nb_popped;
+  }
+
+  for(std::thread& producer : producers)
+  {
+    producer.join();
+  }
+  check(!queue.pop(item), "no element is left after all producers are done");
+}
+
+// The destructor releases the elements that were never popped
+void test_drain_on_destruction()
+{
+  auto counter = std::make_shared<int>(0);
+  {
+    MpscQueue<std::shared_ptr<int>> queue;
+    for(int i = 0; i != 10; ++i)
+    {
+      queue.push(counter);
+    }
+    check(counter.use_count() == 11, "the queue holds the pushed elements");
+  }
+  check(counter.use_count() == 1, "the destructor releases the remaining elements");
+}
+
+}
+
+int main()
+{
+  try
+  {
+    test_single_thread();
+    test_multiple_producers();
+    test_drain_on_destruction();
+  }
+  catch(const std::exception& e)
+  {
+    std::cerr << "mpsc_queue test failed: " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::cout << "All mpsc_queue tests passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,249 @@
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "row_diff.hpp"
+
+using namespace qmlwrap;
+
+namespace
+{
+
+struct Row
+{
+  uint64_t key;
+  uint64_t hash;
+};
+
+void check(bool condition, const std::string& message)
+{
+  if(!condition)
+  {
+    throw std::runtime_error(message);
+  }
+}
+
+std::vector<RowEdit> diff(const std::vector<uint64_t>& old_keys, const std::vector<uint64_t>& new_keys, int max_edits, bool expected = true,
+  const std::vector<uint64_t>& old_hashes = {}, const std::vector<uint64_t>& new_hashes = {})
+{
+  std::vector<RowEdit> edits;
+  const bool result = compute_row_edits(old_keys.data(), old_keys.size(), new_keys.data(), new_keys.size(), max_edits, edits,
+    old_hashes.empty() ? nullptr : old_hashes.data(), new_hashes.empty() ? nullptr : new_hashes.data());
+  check(result == expected, "unexpected result of compute_row_edits");
+  check(result || edits.empty(), "edits must be empty when compute_row_edits fails");
+  return edits;
+}
+
+// Apply the edits the way JuliaItemModel does and check that the new list comes out. Rows that are not replaced must
+// already have their new contents.
+void check_edits(const std::vector<uint64_t>& old_keys, const std::vector<uint64_t>& new_keys, const std::vector<RowEdit>& edits,
+  const std::vector<uint64_t>& old_hashes = {}, const std::vector<uint64_t>& new_hashes = {})
+{
+  std::vector<Row> rows;
+  for(std::size_t i = 0; i != old_keys.size(); ++i)
+  {
+    rows.push_back(Row{old_keys[i], old_hashes.empty() ? 0 : old_hashes[i]});
+  }
+  auto new_row = [&] (int j) { return Row{new_keys[j], new_hashes.empty() ? 0 : new_hashes[j]}; };
+
+  int previous_kind = RowEdit::Remove;
+  for(const RowEdit& edit : edits)
+  {
+    check(edit.kind >= previous_kind, "edits must be ordered as removals, moves, insertions and replacements");
+    previous_kind = edit.kind;
+    check(edit.count > 0, "empty edit");
+    switch(edit.kind)
+    {
+    case RowEdit::Remove:
+      check(edit.first >= 0 && edit.first + edit.count <= int(rows.size()), "removal out of range");
+      rows.erase(rows.begin() + edit.first, rows.begin() + edit.first + edit.count);
+      break;
+    case RowEdit::Move:
+    {
+      check(edit.count == 1 && edit.source >= 0 && edit.source < int(rows.size()) && edit.first < int(rows.size()), "move out of range");
+      const Row row = rows[edit.source];
+      rows.erase(rows.begin() + edit.source);
+      rows.insert(rows.begin() + edit.first, row);
+      break;
+    }
+    case RowEdit::Insert:
+      check(edit.first >= 0 && edit.first <= int(rows.size()), "insertion out of range");
+      for(int i = 0; i != edit.count; ++i)
+      {
+        rows.insert(rows.begin() + edit.first + i, new_row(edit.source + i));
+      }
+      break;
+    case RowEdit::Replace:
+      check(edit.first == edit.source && edit.first + edit.count <= int(rows.size()), "replacement out of range");
+      for(int i = 0; i != edit.count; ++i)
+      {
+        check(rows[edit.first + i].key == new_keys[edit.source + i], "replaced row has a different key");
+        rows[edit.first + i] = new_row(edit.source + i);
+      }
+      break;
+    }
+  }
+
+  check(rows.size() == new_keys.size(), "wrong number of rows after the edits");
+  for(std::size_t j = 0; j != rows.size(); ++j)
+  {
+    check(rows[j].key == new_keys[j], "wrong row order after the edits");
+    check(new_hashes.empty() || rows[j].hash == new_hashes[j], "changed row was not replaced");
+  }
+}
+
+int count_kind(const std::vector<RowEdit>& edits, RowEdit::Kind kind)
+{
+  int result = 0;
+  for(const RowEdit& edit : edits)
+  {
+    result += edit.kind == kind ? 1 : 0;
+  }
+  return result;
+}
+
+void test_empty()
+{
+  check(diff({}, {}, 0).empty(), "two empty lists need no edits");
+
+  const std::vector<uint64_t> keys = {1, 2, 3};
+  std::vector<RowEdit> edits = diff({}, keys, 3);
+  check(edits.size() == 1 && edits[0].kind == RowEdit::Insert && edits[0].first == 0 && edits[0].count == 3, "filling an empty list is a single insertion");
+  check_edits({}, keys, edits);
+
+  edits = diff(keys, {}, 3);
+  check(edits.size() == 1 && edits[0].kind == RowEdit::Remove && edits[0].first == 0 && edits[0].count == 3, "clearing a list is a single removal");
+  check_edits(keys, {}, edits);
+}
+
+void test_max_edits()
+{
+  const std::vector<uint64_t> old_keys = {1, 2, 3, 4};
+  const std::vector<uint64_t> new_keys = {1, 5, 3, 6};
+  // Two removals and two insertions
+  diff(old_keys, new_keys, 3, false);
+  check_edits(old_keys, new_keys, diff(old_keys, new_keys, 4));
+
+  diff(old_keys, {}, 3, false);
+  diff({}, old_keys, 3, false);
+
+  // A negative limit allows no change at all
+  diff(old_keys, new_keys, -1, false);
+  diff(old_keys, {1, 2, 3}, -1, false);
+  check(count_kind(diff(old_keys, old_keys, -1), RowEdit::Replace) == 1, "identical lists only replace the rows");
+}
+
+void test_moves()
+{
+  const std::vector<uint64_t> old_keys = {1, 2, 3, 4, 5};
+  const std::vector<uint64_t> new_keys = {5, 1, 2, 3, 4};
+  std::vector<RowEdit> edits = diff(old_keys, new_keys, 2);
+  check(count_kind(edits, RowEdit::Move) == 1 && count_kind(edits, RowEdit::Remove) == 0 && count_kind(edits, RowEdit::Insert) == 0,
+    "a row moved to the front is a single move");
+  check_edits(old_keys, new_keys, edits);
+
+  const std::vector<uint64_t> swapped = {4, 2, 3, 1, 5};
+  edits = diff(old_keys, swapped, 10);
+  check(count_kind(edits, RowEdit::Remove) == 0 && count_kind(edits, RowEdit::Insert) == 0, "swapped rows are moved");
+  check_edits(old_keys, swapped, edits);
+
+  // Rows with duplicated keys
+  const std::vector<uint64_t> duplicates = {1, 2, 1, 3};
+  const std::vector<uint64_t> reordered = {3, 1, 2, 1};
+  edits = diff(duplicates, reordered, 10);
+  check_edits(duplicates, reordered, edits);
+}
+
+void test_hashes()
+{
+  const std::vector<uint64_t> keys = {1, 2, 3, 4, 5};
+  const std::vector<uint64_t> old_hashes = {10, 20, 30, 40, 50};
+  const std::vector<uint64_t> new_hashes = {10, 21, 31, 40, 51};
+  const std::vector<RowEdit> edits = diff(keys, keys, 0, true, old_hashes, new_hashes);
+  check(edits.size() == 2 && edits[0].first == 1 && edits[0].count == 2 && edits[1].first == 4 && edits[1].count == 1,
+    "only the rows with a different hash are replaced");
+  check_edits(keys, keys, edits, old_hashes, new_hashes);
+
+  check(diff(keys, keys, 0, true, old_hashes, old_hashes).empty(), "unchanged hashes need no edits");
+}
+
+void test_random()
+{
+  std::mt19937 rng(42);
+  for(int iteration = 0; iteration != 2000; ++iteration)
+  {
+    const int nb_keys = 1 + int(rng() % 20);
+    std::vector<uint64_t> old_keys;
+    std::vector<uint64_t> old_hashes;
+    for(int i = int(rng() % 16); i != 0; --i)
+    {
+      old_keys.push_back(rng() % nb_keys);
+      old_hashes.push_back(rng() % 3);
+    }
+    std::vector<uint64_t> new_keys = old_keys;
+    std::vector<uint64_t> new_hashes = old_hashes;
+    for(int i = int(rng() % 6); i != 0; --i)
+    {
+      const std::size_t n = new_keys.size();
+      switch(rng() % 4)
+      {
+      case 0:
+      {
+        const std::size_t at = rng() % (n + 1);
+        new_keys.insert(new_keys.begin() + at, rng() % nb_keys);
+        new_hashes.insert(new_hashes.begin() + at, rng() % 3);
+        break;
+      }
+      case 1:
+        if(n != 0)
+        {
+          const std::size_t at = rng() % n;
+          new_keys.erase(new_keys.begin() + at);
+          new_hashes.erase(new_hashes.begin() + at);
+        }
+        break;
+      case 2:
+        if(n > 1)
+        {
+          std::swap(new_keys[rng() % n], new_keys[rng() % n]);
+        }
+        break;
+      default:
+        if(n != 0)
+        {
+          new_hashes[rng() % n] = rng() % 3;
+        }
+        break;
+      }
+    }
+    std::vector<RowEdit> edits = diff(old_keys, new_keys, 64);
+    check_edits(old_keys, new_keys, edits);
+    edits = diff(old_keys, new_keys, 64, true, old_hashes, new_hashes);
+    check_edits(old_keys, new_keys, edits, old_hashes, new_hashes);
+  }
+}
+
+}
+
+int main()
+{
+  try
+  {
+    test_empty();
+    test_max_edits();
+    test_moves();
+    test_hashes();
+    test_random();
+  }
+  catch(const std::exception& e)
+  {
+    std::cerr << "row_diff test failed: " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::cout << "All row_diff tests passed" << std::endl;
+  return 0;
+}
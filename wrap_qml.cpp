@@ -8,6 +8,7 @@ JLCXX_MODULE define_julia_module(jlcxx::Module& qml_module)
   qmlwrap::JuliaFunction::m_qml_mod = qml_module.julia_module();
   qmlwrap::ApplicationManager::m_qml_mod = qml_module.julia_module();
   qmlwrap::JuliaItemModel::m_qml_mod = qml_module.julia_module();
+  qmlwrap::JuliaTreeModel::m_qml_mod = qml_module.julia_module();
 
   qml_module.method("define_julia_module_makie", [](jl_value_t* mod)
   {
@@ -31,6 +32,17 @@ JLCXX_MODULE define_julia_module(jlcxx::Module& qml_module)
     })
   );
   
+  qml_module.add_enum<Qt::SortOrder>("SortOrder",
+    std::vector<const char*>({
+      "AscendingOrder",
+      "DescendingOrder"
+    }),
+    std::vector<int>({
+      Qt::AscendingOrder,
+      Qt::DescendingOrder
+    })
+  );
+
   qml_module.add_enum<Qt::ItemDataRole>("ItemDataRole",
     std::vector<const char*>({
       "DisplayRole",
@@ -18,7 +18,9 @@
 
 #include "application_manager.hpp"
 #include "foreign_thread_manager.hpp"
+#include "gc_frame_guard.hpp"
 #include "julia_api.hpp"
+#include "julia_array.hpp"
 #include "julia_canvas.hpp"
 #include "julia_display.hpp"
 #include "julia_imageprovider.hpp"
@@ -26,7 +28,11 @@
 #include "julia_painteditem.hpp"
 #include "julia_property_map.hpp"
 #include "julia_signals.hpp"
+#include "julia_sortfilterproxymodel.hpp"
+#include "julia_treemodel.hpp"
 #include "opengl_viewport.hpp"
+#include "qvariant_conversion.hpp"
+#include "string_conversion.hpp"
 #include "makie_viewport.hpp"
 
 #include "jlqml.hpp"
@@ -54,6 +60,9 @@ template<> struct SuperType<QQuickItem> { using type = QObject; };
 template<> struct SuperType<QWindow> { using type = QObject; };
 template<> struct SuperType<QQuickWindow> { using type = QWindow; };
 template<> struct SuperType<qmlwrap::JuliaItemModel> { using type = QAbstractTableModel; };
+template<> struct SuperType<qmlwrap::JuliaTreeModel> { using type = QAbstractItemModel; };
+template<> struct SuperType<QAbstractProxyModel> { using type = QAbstractItemModel; };
+template<> struct SuperType<qmlwrap::JuliaSortFilterProxyModel> { using type = QAbstractProxyModel; };
 template<> struct SuperType<QImage> { using type = QPaintDevice; };
 template<> struct SuperType<QPixmap> { using type = QPaintDevice; };
 template<> struct SuperType<QQmlImageProviderBase> { using type = QObject; };
@@ -66,12 +75,44 @@ namespace qmlwrap
 {
 
 using qvariant_types = jlcxx::ParameterList<bool, float, double, int32_t, int64_t, uint32_t, uint64_t, void*, jl_value_t*,
-  QString, QUrl, jlcxx::SafeCFunction, QVariantMap, QVariantList, QStringList, QList<QUrl>, JuliaDisplay*, JuliaCanvas*, JuliaPropertyMap*, QObject*>;
+  QString, QUrl, jlcxx::SafeCFunction, QVariantMap, QVariantList, QStringList, QList<QUrl>, QByteArray, JuliaArray, JuliaDisplay*, JuliaCanvas*, JuliaPropertyMap*, QObject*>;
 
 inline std::map<int, jl_datatype_t*> g_variant_type_map;
 
+// Flat copies of g_variant_type_map indexed by meta type id, for built-in types and for types from QMetaType::User on
+inline std::vector<jl_datatype_t*> g_builtin_variant_types;
+inline std::vector<jl_datatype_t*> g_user_variant_types;
+
+// To be called once all types are added to g_variant_type_map. Types added later are still found, through the map.
+inline void build_variant_type_table()
+{
+  g_builtin_variant_types.clear();
+  g_user_variant_types.clear();
+  for(const auto& [id, dt] : g_variant_type_map)
+  {
+    const bool builtin = id < QMetaType::User;
+    std::vector<jl_datatype_t*>& table = builtin ? g_builtin_variant_types : g_user_variant_types;
+    const std::size_t index = builtin ? id : id - QMetaType::User;
+    if(index >= table.size())
+    {
+      table.resize(index + 1, nullptr);
+    }
+    table[index] = dt;
+  }
+}
+
 inline jl_datatype_t* julia_type_from_qt_id(int id)
 {
+    if(id >= 0)
+    {
+      const bool builtin = id < QMetaType::User;
+      const std::vector<jl_datatype_t*>& table = builtin ? g_builtin_variant_types : g_user_variant_types;
+      const std::size_t index = builtin ? id : id - QMetaType::User;
+      if(index < table.size() && table[index] != nullptr)
+      {
+        return table[index];
+      }
+    }
     if(qmlwrap::g_variant_type_map.count(id) == 0)
     {
       qWarning() << "invalid variant type " << QMetaType(id).name();
@@ -80,6 +121,28 @@ inline jl_datatype_t* julia_type_from_qt_id(int id)
     return qmlwrap::g_variant_type_map[id];
 }
 
+// Julia type for the QObjects that need a specific one, nullptr for all others
+inline jl_datatype_t* julia_qobject_type(QObject* obj)
+{
+  // Checks the class chain of the meta object, like qobject_cast
+  const QMetaObject* mo = obj->metaObject();
+  if(mo->inherits(&JuliaDisplay::staticMetaObject))
+  {
+    return jlcxx::julia_base_type<JuliaDisplay*>();
+  }
+  if(mo->inherits(&JuliaCanvas::staticMetaObject))
+  {
+    return jlcxx::julia_base_type<JuliaCanvas*>();
+  }
+  // JuliaPropertyMap has no meta object of its own, so only property maps need the dynamic_cast
+  if(mo->inherits(&QQmlPropertyMap::staticMetaObject) && dynamic_cast<JuliaPropertyMap*>(obj) != nullptr)
+  {
+    static jl_datatype_t* propertymap_type = (jl_datatype_t*)jlcxx::julia_type("JuliaPropertyMap");
+    return propertymap_type;
+  }
+  return nullptr;
+}
+
 inline jl_datatype_t* julia_variant_type(const QVariant& v)
 {
   if(!v.isValid())
@@ -87,33 +150,27 @@ inline jl_datatype_t* julia_variant_type(const QVariant& v)
     static jl_datatype_t* nothing_type = (jl_datatype_t*)jlcxx::julia_type("Nothing");
     return nothing_type;
   }
-  const int usertype = v.userType();
-  if(usertype == qMetaTypeId<QJSValue>())
+  const QMetaType metatype = v.metaType();
+  static const int jsvalue_id = qMetaTypeId<QJSValue>();
+  if(metatype.id() == jsvalue_id)
   {
     return julia_variant_type(v.value<QJSValue>().toVariant());
   }
   // Convert to some known, specific type if necessary
-  if(v.canConvert<QObject*>())
+  if(metatype.flags().testFlag(QMetaType::PointerToQObject))
   {
-    QObject* obj = v.value<QObject*>();
+    QObject* obj = *static_cast<QObject* const*>(v.constData());
     if(obj != nullptr)
     {
-      if(qobject_cast<JuliaDisplay*>(obj) != nullptr)
-      {
-        return jlcxx::julia_base_type<JuliaDisplay*>();
-      }
-      if(qobject_cast<JuliaCanvas*>(obj) != nullptr)
-      {
-        return jlcxx::julia_base_type<JuliaCanvas*>();
-      }
-      if(dynamic_cast<JuliaPropertyMap*>(obj) != nullptr)
+      jl_datatype_t* qobject_type = julia_qobject_type(obj);
+      if(qobject_type != nullptr)
       {
-        return (jl_datatype_t*)jlcxx::julia_type("JuliaPropertyMap");
+        return qobject_type;
       }
     }
   }
 
-  return julia_type_from_qt_id(usertype);
+  return julia_type_from_qt_id(metatype.id());
 }
 
 template<typename T>
@@ -151,17 +208,17 @@ struct ApplyQVariant<jl_value_t*>
     {
       if(v.userType() == qMetaTypeId<QJSValue>())
       {
-        return v.value<QJSValue>().toVariant().value<qvariant_any_t>()->value;
+        return v.value<QJSValue>().toVariant().value<qvariant_any_t>().value();
       }
-      return v.value<qvariant_any_t>()->value;
+      return v.value<qvariant_any_t>().value();
     });
     wrapper.module().method("setValue", [] (jlcxx::SingletonType<jl_value_t*>, QVariant& v, jl_value_t* val)
     {
-      v.setValue(std::make_shared<QVariantAny>(val));
+      v.setValue(qvariant_any_t(val));
     });
     wrapper.module().method("QVariant", [] (jlcxx::SingletonType<jl_value_t*>, jl_value_t* val)
     {
-      return QVariant::fromValue(std::make_shared<QVariantAny>(val));
+      return QVariant::fromValue(qvariant_any_t(val));
     });
   }
 };
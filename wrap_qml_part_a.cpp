@@ -31,6 +31,16 @@ void wrap_part_a(jlcxx::Module& qml_module)
     .method("cppsize", &QString::size);
   qml_module.method("uint16char", [] (const QString& s, int i) { return static_cast<uint16_t>(s[i].unicode()); });
   qml_module.method("fromStdWString", QString::fromStdWString);
+  // Whole string conversions, instead of iterating over the QString from Julia
+  qml_module.method("julia_string", [] (const QString& s) { return qmlwrap::julia_string(s); });
+  qml_module.method("fromJuliaString", [] (jl_value_t* s)
+  {
+    if(!jl_is_string(s))
+    {
+      throw std::runtime_error("fromJuliaString requires a String");
+    }
+    return qmlwrap::julia_to_qstring(s);
+  });
   qml_module.method("isvalidindex", [] (const QString& s, int i)
   {
     if(i < 0 || i >= s.size())
@@ -82,6 +92,12 @@ void wrap_part_a(jlcxx::Module& qml_module)
 
   qml_module.add_type<QByteArrayView>("QByteArrayView");
 
+  qml_module.add_type<qmlwrap::JuliaArray>("JuliaArray")
+    .constructor<jl_value_t*>()
+    .method("julia_array", &qmlwrap::JuliaArray::julia_array);
+  // Array with the given element type from the bytes of an ArrayBuffer passed by QML
+  qml_module.method("julia_array", &qmlwrap::JuliaArray::from_bytes);
+
   qml_module.add_type<Parametric<TypeVar<1>>>("QList", julia_type("AbstractVector"))
     .apply<QVariantList, QList<QString>, QList<QUrl>, QList<QByteArray>, QList<int>, QList<QObject*>>(qmlwrap::WrapQList());
 
@@ -122,6 +138,10 @@ void wrap_part_a(jlcxx::Module& qml_module)
     .method("set_julia_value", &qmlwrap::JuliaPropertyMap::set_julia_value);
 
   jlcxx::for_each_parameter_type<qmlwrap::qvariant_types>(qmlwrap::WrapQVariant(qvar_type));
+  qmlwrap::build_variant_type_table();
+  // Whole trees of Dicts, Vectors and NamedTuples in a single call, instead of one call per node
+  qml_module.method("julia_to_qvariant", &qmlwrap::julia_to_qvariant);
+  qml_module.method("qvariant_to_julia", &qmlwrap::qvariant_to_julia);
   qml_module.method("type", qmlwrap::julia_variant_type);
 
   qml_module.method("make_qvariant_map", [] ()
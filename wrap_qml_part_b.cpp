@@ -120,6 +120,7 @@ void wrap_part_b(jlcxx::Module& qml_module)
   qml_module.method("queue_process_eventloop_updates", []() { qmlwrap::ApplicationManager::instance().queue_process_eventloop_updates(); });
 
   qml_module.method("yield", []() { qmlwrap::ForeignThreadManager::instance().yield(); });
+  qml_module.method("yield_to_higher_priority", []() { qmlwrap::ForeignThreadManager::instance().yield_to_higher_priority(); });
 
   qml_module.add_type<QTimer>("QTimer", julia_base_type<QObject>())
     .constructor<QObject*>()
@@ -129,7 +130,11 @@ void wrap_part_b(jlcxx::Module& qml_module)
     .method("callOnTimeout", [] (QTimer& t, jl_value_t* julia_function)
     {
       JuliaFunction f(julia_function);
-      t.callOnTimeout([f] () { f(); });
+      t.callOnTimeout([f] ()
+      {
+        qmlwrap::GCGuard gc_guard(qmlwrap::JuliaPriority::Normal, "QTimer::timeout");
+        f();
+      });
     });
 
   // Emit signals helper
@@ -147,6 +152,23 @@ void wrap_part_b(jlcxx::Module& qml_module)
   qml_module.method("qmlfunction", [](const QString &name, jl_value_t *f) {
     qmlwrap::ApplicationManager::instance().julia_api()->register_function(name, f);
   });
+  qml_module.method("function_registration_stats", []() {
+    return qmlwrap::ApplicationManager::instance().julia_api()->registration_stats();
+  });
+  qml_module.method("set_function_profiling", [](bool enabled) {
+    qmlwrap::ApplicationManager::instance().julia_api()->set_call_profiling(enabled);
+  });
+  qml_module.method("function_profile", []() {
+    return qmlwrap::ApplicationManager::instance().julia_api()->call_profile();
+  });
+  qml_module.method("reset_function_profile", []() {
+    qmlwrap::ApplicationManager::instance().julia_api()->reset_call_profile();
+  });
+  // Reported by the call trampoline, with the time it spent converting the arguments and the result
+  qml_module.method("add_conversion_time", &qmlwrap::CallProfile::add_conversion_time);
+  qml_module.method("qmlfunction_typed", [](const QString &name, jlcxx::SafeCFunction f) {
+    qmlwrap::ApplicationManager::instance().julia_api()->register_typed_function(name, f);
+  });
 
   qml_module.add_type<QPaintDevice>("QPaintDevice")
     .method("width", &QPaintDevice::width)
@@ -176,10 +198,43 @@ void wrap_part_b(jlcxx::Module& qml_module)
     .method("begin_remove_columns", &qmlwrap::JuliaItemModel::begin_remove_columns)
     .method("end_remove_columns", &qmlwrap::JuliaItemModel::end_remove_columns)
     .method("default_role_names", &qmlwrap::JuliaItemModel::default_role_names)
-    .method("get_julia_data", &qmlwrap::JuliaItemModel::get_julia_data);
+    .method("get_julia_data", &qmlwrap::JuliaItemModel::get_julia_data)
+    .method("set_role_getter", &qmlwrap::JuliaItemModel::set_role_getter)
+    .method("clear_role_getters", &qmlwrap::JuliaItemModel::clear_role_getters)
+    .method("count_cache_hits", &qmlwrap::JuliaItemModel::count_cache_hits)
+    .method("set_tile_size", &qmlwrap::JuliaItemModel::set_tile_size)
+    .method("tile_cache_misses", &qmlwrap::JuliaItemModel::tile_cache_misses)
+    .method("set_native_column", &qmlwrap::JuliaItemModel::set_native_column)
+    .method("clear_native_columns", &qmlwrap::JuliaItemModel::clear_native_columns)
+    .method("set_fetch_policy", &qmlwrap::JuliaItemModel::set_fetch_policy)
+    .method("set_batch_updates", &qmlwrap::JuliaItemModel::set_batch_updates)
+    .method("set_flush_window", &qmlwrap::JuliaItemModel::set_flush_window)
+    .method("flush_data_changes", &qmlwrap::JuliaItemModel::flush_data_changes)
+    .method("update_rows", static_cast<bool(qmlwrap::JuliaItemModel::*)(jl_value_t*, jlcxx::ArrayRef<uint64_t>, jlcxx::ArrayRef<uint64_t>, int)>(&qmlwrap::JuliaItemModel::update_rows))
+    .method("update_rows", static_cast<bool(qmlwrap::JuliaItemModel::*)(jl_value_t*, jlcxx::ArrayRef<uint64_t>, jlcxx::ArrayRef<uint64_t>, jlcxx::ArrayRef<uint64_t>, jlcxx::ArrayRef<uint64_t>, int)>(&qmlwrap::JuliaItemModel::update_rows))
+    .method("push_rows", &qmlwrap::JuliaItemModel::push_rows)
+    .method("set_max_rows_per_drain", &qmlwrap::JuliaItemModel::set_max_rows_per_drain)
+    .method("drain_row_queue", &qmlwrap::JuliaItemModel::drain_row_queue);
 
   qml_module.method("new_item_model", [] (jl_value_t* modeldata) { return jlcxx::create<qmlwrap::JuliaItemModel>(modeldata); });
 
+  qml_module.add_type<qmlwrap::JuliaTreeModel>("JuliaTreeModel", julia_base_type<QAbstractItemModel>())
+    .method("reload", &qmlwrap::JuliaTreeModel::reload)
+    .method("get_julia_root", &qmlwrap::JuliaTreeModel::get_julia_root)
+    .method("loaded_node_count", &qmlwrap::JuliaTreeModel::loaded_node_count);
+
+  qml_module.method("new_tree_model", [] (jl_value_t* root) { return jlcxx::create<qmlwrap::JuliaTreeModel>(root); });
+
+  qml_module.add_type<QAbstractProxyModel>("QAbstractProxyModel", julia_base_type<QAbstractItemModel>());
+  qml_module.add_type<qmlwrap::JuliaSortFilterProxyModel>("JuliaSortFilterProxyModel", julia_base_type<QAbstractProxyModel>())
+    .method("sort_by_column", &qmlwrap::JuliaSortFilterProxyModel::sort)
+    .method("sort_column", &qmlwrap::JuliaSortFilterProxyModel::sort_column)
+    .method("set_filter", &qmlwrap::JuliaSortFilterProxyModel::set_filter)
+    .method("clear_filter", &qmlwrap::JuliaSortFilterProxyModel::clear_filter)
+    .method("invalidate", &qmlwrap::JuliaSortFilterProxyModel::invalidate);
+
+  qml_module.method("new_sort_filter_proxy_model", [] (qmlwrap::JuliaItemModel* source) { return jlcxx::create<qmlwrap::JuliaSortFilterProxyModel>(source); });
+
   qml_module.set_override_module(jl_base_module);
   qml_module.method("getindex", [](const QVariantMap& m, const QString& key) { return m[key]; });
   qml_module.unset_override_module();
@@ -364,4 +419,19 @@ void wrap_part_b(jlcxx::Module& qml_module)
 
   qml_module.add_type<Parametric<TypeVar<1>>>("ImageResult")
     .apply<qmlwrap::ImageResult<QImage>, qmlwrap::ImageResult<QPixmap>>(qmlwrap::WrapImageResult());
+
+  qml_module.method("set_lock_profiling", &qmlwrap::LockProfiler::set_enabled);
+  qml_module.method("reset_lock_stats", &qmlwrap::LockProfiler::reset);
+  qml_module.method("lock_stats", &qmlwrap::LockProfiler::stats);
+  qml_module.method("lock_stats_report", &qmlwrap::LockProfiler::report);
+  qml_module.method("set_thread_pool_size", &qmlwrap::ForeignThreadManager::set_thread_pool_size);
+  qml_module.method("thread_stats", &qmlwrap::ForeignThreadManager::thread_stats);
+  qml_module.method("attach_gc_frame_guard", &qmlwrap::GCFrameGuard::attach);
+  qml_module.method("detach_gc_frame_guard", &qmlwrap::GCFrameGuard::detach);
+  qml_module.method("begin_gc_frame", &qmlwrap::GCFrameGuard::begin_frame);
+  qml_module.method("end_gc_frame", &qmlwrap::GCFrameGuard::end_frame);
+  qml_module.method("set_max_gc_deferral", &qmlwrap::GCFrameGuard::set_max_deferral);
+  qml_module.method("gc_frame_stats", &qmlwrap::GCFrameGuard::stats);
+  qml_module.method("reset_gc_frame_stats", &qmlwrap::GCFrameGuard::reset_stats);
+  qml_module.method("gc_root_stats", [] () { return qmlwrap::GCRootArena::instance().stats(); });
 }